@@ -0,0 +1,239 @@
+/*
+ * Скорость разбора JSON на сгенерированном документе в формате входных данных справочника: base_requests
+ * с остановками и автобусами и stat_requests. Документ разбирается через оба входа json::Load -- из потока
+ * и из буфера в памяти (SSE2 и from_chars), -- и для каждого печатается скорость в МБ/с (лучший из повторов).
+ * Затем замеряется обработка запросов, в которой основное время уходит на поиск по ключам json::Dict:
+ * заполнение справочника из уже разобранного документа и потоково, прямо при разборе, и ответы на запросы
+ * Bus и Stop. Запросов Route в документе нет -- их скорость определяется маршрутизатором (см. router_bench).
+ *
+ * Сборка из каталога transport-catalogue:
+ *     g++ -std=c++20 -O2 -I. -Imap_renderer -Itransport_router $(find . -name '*.cpp' ! -name main.cpp \
+ *         ! -path './bench*' ! -path './tests*') bench/json_bench.cpp -o json_bench -lpthread
+ */
+
+#include "json.h"
+#include "json_reader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+using namespace std::literals;
+
+namespace {
+
+struct Options {
+    size_t stop_count = 10000;
+    size_t bus_count = 1000;
+    size_t bus_stops = 40;
+    size_t request_count = 20000;
+    size_t repeat_count = 5;
+    unsigned seed = 1;
+};
+
+void PrintUsage() {
+    std::cerr << "Usage: json_bench [--stops N] [--buses N] [--bus-stops N] [--requests N] [--repeat N] [--seed N]\n"sv;
+}
+
+bool ParseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string_view key(argv[i]);
+        const size_t value = std::stoul(argv[i + 1]);
+        if (key == "--stops"sv) {
+            options.stop_count = value;
+        } else if (key == "--buses"sv) {
+            options.bus_count = value;
+        } else if (key == "--bus-stops"sv) {
+            options.bus_stops = value;
+        } else if (key == "--requests"sv) {
+            options.request_count = value;
+        } else if (key == "--repeat"sv) {
+            options.repeat_count = value;
+        } else if (key == "--seed"sv) {
+            options.seed = static_cast<unsigned>(value);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && options.stop_count > 1 && options.bus_stops > 1 && options.repeat_count > 0;
+}
+
+// поток, выбрасывающий всё записанное: ответы на запросы нужны только ради времени их построения
+class NullBuffer final : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+// каждое десятое название с кавычками, чтобы разбор проходил и по экранированным строкам
+std::string MakeStopName(size_t index) {
+    return index % 10 == 0 ? "Stop \"" + std::to_string(index) + '"' : "Stop "s + std::to_string(index);
+}
+
+// документ пишется json::Writer с отступами, как выглядят настоящие входные данные
+std::string GenerateDocument(const Options& options) {
+    std::mt19937 random(options.seed);
+    std::uniform_real_distribution<double> offset(0.0, 0.09);
+    std::uniform_int_distribution<size_t> stop_index(0, options.stop_count - 1);
+    std::uniform_int_distribution<int> distance(100, 5000);
+    
+    std::ostringstream oss;
+    json::Writer writer(oss, 4, 0);
+    writer.StartDict();
+    
+    writer.Key("base_requests"sv);
+    writer.StartArray();
+    for (size_t stop = 0; stop < options.stop_count; ++stop) {
+        writer.StartDict();
+        writer.Key("type"sv);
+        writer.StringValue("Stop"sv);
+        writer.Key("name"sv);
+        writer.StringValue(MakeStopName(stop));
+        writer.Key("latitude"sv);
+        writer.Value(55.7 + offset(random));
+        writer.Key("longitude"sv);
+        writer.Value(37.5 + offset(random));
+        writer.Key("road_distances"sv);
+        writer.StartDict();
+        for (int i = 0; i < 3; ++i) {
+            writer.Key(MakeStopName(stop_index(random)));
+            writer.Value(distance(random));
+        }
+        writer.EndDict();
+        writer.EndDict();
+    }
+    for (size_t bus = 0; bus < options.bus_count; ++bus) {
+        writer.StartDict();
+        writer.Key("type"sv);
+        writer.StringValue("Bus"sv);
+        writer.Key("name"sv);
+        writer.StringValue("Bus "s + std::to_string(bus));
+        writer.Key("stops"sv);
+        writer.StartArray();
+        for (size_t i = 0; i < options.bus_stops; ++i) {
+            writer.StringValue(MakeStopName(stop_index(random)));
+        }
+        writer.EndArray();
+        writer.Key("is_roundtrip"sv);
+        writer.Value(bus % 2 == 0);
+        writer.EndDict();
+    }
+    writer.EndArray();
+    
+    writer.Key("routing_settings"sv);
+    writer.StartDict();
+    writer.Key("bus_velocity"sv);
+    writer.Value(40);
+    writer.Key("bus_wait_time"sv);
+    writer.Value(6);
+    writer.EndDict();
+    
+    writer.Key("stat_requests"sv);
+    writer.StartArray();
+    for (size_t request = 0; request < options.request_count; ++request) {
+        writer.StartDict();
+        writer.Key("id"sv);
+        writer.Value(static_cast<int>(request + 1));
+        if (request % 2 == 0 && options.bus_count > 0) {
+            writer.Key("type"sv);
+            writer.StringValue("Bus"sv);
+            writer.Key("name"sv);
+            writer.StringValue("Bus "s + std::to_string(stop_index(random) % options.bus_count));
+        } else {
+            writer.Key("type"sv);
+            writer.StringValue("Stop"sv);
+            writer.Key("name"sv);
+            writer.StringValue(MakeStopName(stop_index(random)));
+        }
+        writer.EndDict();
+    }
+    writer.EndArray();
+    
+    writer.EndDict();
+    return std::move(oss).str();
+}
+
+// лучший из повторов: на загруженной машине он меньше всего зависит от соседей
+template <typename Function>
+double MeasureBestMilliseconds(size_t repeat_count, Function function) {
+    double best_ms = 0.0;
+    for (size_t i = 0; i < repeat_count; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best_ms = i == 0 ? ms : std::min(best_ms, ms);
+    }
+    return best_ms;
+}
+
+void PrintThroughput(std::string_view name, size_t bytes, double ms) {
+    std::printf("%-26s %10.1f ms  %8.1f MB/s\n", std::string(name).c_str(), ms,
+                static_cast<double>(bytes) / (1024.0 * 1024.0) / (ms / 1000.0));
+    std::fflush(stdout);
+}
+
+void PrintTime(std::string_view name, double ms) {
+    std::printf("%-26s %10.1f ms\n", std::string(name).c_str(), ms);
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        if (!ParseOptions(argc, argv, options)) {
+            PrintUsage();
+            return 1;
+        }
+    } catch (const std::exception&) {
+        PrintUsage();
+        return 1;
+    }
+    
+    const std::string text = GenerateDocument(options);
+    std::printf("document %.1f MB: %zu stops, %zu buses of %zu stops, %zu stat requests\n",
+                static_cast<double>(text.size()) / (1024.0 * 1024.0), options.stop_count, options.bus_count,
+                options.bus_stops, options.request_count);
+    
+    // оба входа должны строить одинаковый документ
+    std::istringstream iss(text);
+    if (!(json::Load(iss) == json::Load(std::string_view(text)))) {
+        std::cerr << "Documents loaded from stream and from buffer differ\n"sv;
+        return 1;
+    }
+    
+    // копия текста в поток входит в замер: так же платит и чтение из std::cin
+    PrintThroughput("Load(std::istream&)"sv, text.size(), MeasureBestMilliseconds(options.repeat_count, [&text] {
+        std::istringstream iss(text);
+        json::Load(iss);
+    }));
+    PrintThroughput("Load(std::string_view)"sv, text.size(), MeasureBestMilliseconds(options.repeat_count, [&text] {
+        json::Load(std::string_view(text));
+    }));
+    
+    NullBuffer null_buffer;
+    std::ostream null_output(&null_buffer);
+    
+    // разбор документа сюда не входит, только заполнение справочника из него
+    const json::Document document = json::Load(std::string_view(text));
+    PrintTime("ProcessBaseRequests()"sv, MeasureBestMilliseconds(options.repeat_count, [&] {
+        catalogue::TransportCatalogue catalogue;
+        json::JsonReader(catalogue, document, null_output).ProcessBaseRequests();
+    }));
+    PrintTime("ProcessBaseRequests(text)"sv, MeasureBestMilliseconds(options.repeat_count, [&text] {
+        catalogue::TransportCatalogue catalogue;
+        json::JsonReader::ProcessBaseRequests(std::string_view(text), catalogue);
+    }));
+    
+    catalogue::TransportCatalogue catalogue;
+    const json::Document requests = json::JsonReader::ProcessBaseRequests(std::string_view(text), catalogue);
+    PrintTime("stat requests"sv, MeasureBestMilliseconds(options.repeat_count, [&] {
+        json::JsonReader(catalogue, requests, null_output).PrintCompactStats();
+    }));
+}
@@ -0,0 +1,330 @@
+/*
+ * Сравнение алгоритмов поиска пути на сгенерированной сети: время построения маршрутизатора (граф и предрасчёт),
+ * прирост занятой памяти и время ответа на запрос маршрута. Для каждой модели графа отдельно печатаются
+ * время построения самого графа и память под его рёбра. Флойд-Уоршелл запускается с разным числом потоков
+ * (--threads, по умолчанию степени двойки до числа ядер), чтобы было видно масштабирование предрасчёта.
+ * По умолчанию сеть -- 600 остановок и 60 кольцевых маршрутов по 40-120 остановок; все алгоритмы отвечают
+ * на одни и те же запросы, и контрольная сумма найденных маршрутов у них должна совпадать. Память -- прирост
+ * резидентной памяти процесса за построение, поэтому она учитывает и граф, и предрасчёт.
+ *
+ * Сборка из каталога transport-catalogue:
+ *     g++ -std=c++20 -O2 -I. -Itransport_router transport_catalogue.cpp string_pool.cpp geo.cpp \
+ *         transport_router/transport_router.cpp bench/router_bench.cpp -o router_bench -lpthread
+ */
+
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <unistd.h>
+
+using namespace std::literals;
+
+namespace {
+
+std::vector<size_t> DefaultThreadCounts() {
+    const size_t max_count = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> result;
+    for (size_t count = 1; count < max_count; count *= 2) {
+        result.push_back(count);
+    }
+    result.push_back(max_count);
+    return result;
+}
+
+struct Options {
+    size_t stop_count = 600;
+    size_t bus_count = 60;
+    size_t min_bus_stops = 40;
+    size_t max_bus_stops = 120;
+    size_t query_count = 1000;
+    unsigned seed = 1;
+    std::vector<std::string> routers{"floyd_warshall", "dijkstra", "radix_dijkstra", "a_star", "contraction_hierarchy"};
+    std::vector<std::string> graphs{"all_spans", "ride_chains"};
+    std::vector<size_t> thread_counts = DefaultThreadCounts();
+};
+
+void PrintUsage() {
+    std::cerr << "Usage: router_bench [--stops N] [--buses N] [--min-bus-stops N] [--max-bus-stops N]\n"
+                 "                    [--queries N] [--seed N] [--routers name,...] [--graphs name,...]\n"
+                 "                    [--threads N,...]\n"sv;
+}
+
+std::vector<std::string> SplitList(std::string_view list) {
+    std::vector<std::string> result;
+    std::istringstream iss{std::string(list)};
+    for (std::string item; std::getline(iss, item, ',');) {
+        result.push_back(item);
+    }
+    return result;
+}
+
+bool ParseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string_view key(argv[i]);
+        const std::string_view value(argv[i + 1]);
+        if (key == "--stops"sv) {
+            options.stop_count = std::stoul(std::string(value));
+        } else if (key == "--buses"sv) {
+            options.bus_count = std::stoul(std::string(value));
+        } else if (key == "--min-bus-stops"sv) {
+            options.min_bus_stops = std::stoul(std::string(value));
+        } else if (key == "--max-bus-stops"sv) {
+            options.max_bus_stops = std::stoul(std::string(value));
+        } else if (key == "--queries"sv) {
+            options.query_count = std::stoul(std::string(value));
+        } else if (key == "--seed"sv) {
+            options.seed = std::stoul(std::string(value));
+        } else if (key == "--routers"sv) {
+            options.routers = SplitList(value);
+        } else if (key == "--graphs"sv) {
+            options.graphs = SplitList(value);
+        } else if (key == "--threads"sv) {
+            options.thread_counts.clear();
+            for (const std::string& count : SplitList(value)) {
+                options.thread_counts.push_back(std::stoul(count));
+            }
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && options.stop_count > 1 && options.min_bus_stops > 1
+        && options.min_bus_stops <= options.max_bus_stops && !options.thread_counts.empty()
+        && std::find(options.thread_counts.begin(), options.thread_counts.end(), 0) == options.thread_counts.end();
+}
+
+// занятая процессом память в байтах; свободная память кучи перед замером возвращается системе
+size_t GetResidentMemory() {
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+    size_t total_pages = 0, resident_pages = 0;
+    if (FILE* statm = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(statm, "%zu %zu", &total_pages, &resident_pages) != 2) {
+            resident_pages = 0;
+        }
+        std::fclose(statm);
+    }
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// остановки в квадрате около 10 x 10 км, дороги на 10-50% длиннее расстояния по прямой
+void GenerateNetwork(const Options& options, catalogue::TransportCatalogue& catalogue) {
+    std::mt19937 random(options.seed);
+    std::uniform_real_distribution<double> offset(0.0, 0.09);
+    std::uniform_real_distribution<double> detour(1.1, 1.5);
+    std::uniform_int_distribution<size_t> stop_index(0, options.stop_count - 1);
+    std::uniform_int_distribution<size_t> bus_stops(options.min_bus_stops, options.max_bus_stops);
+    
+    std::vector<std::string> stop_names;
+    std::vector<geo::Coordinates> coords;
+    catalogue::TransportCatalogue::Builder builder;
+    for (size_t i = 0; i < options.stop_count; ++i) {
+        stop_names.push_back("Stop "s + std::to_string(i));
+        coords.push_back({55.7 + offset(random), 37.5 + offset(random)});
+        builder.AddStop(stop_names.back(), coords.back());
+    }
+    
+    for (size_t bus = 0; bus < options.bus_count; ++bus) {
+        std::vector<size_t> stops(bus_stops(random));
+        for (size_t& stop : stops) {
+            stop = stop_index(random);
+        }
+        // кольцевой маршрут заканчивается на своей первой остановке
+        stops.push_back(stops.front());
+        
+        std::vector<std::string_view> route;
+        for (size_t i = 0; i < stops.size(); ++i) {
+            route.push_back(stop_names[stops[i]]);
+            if (i > 0) {
+                const double length = geo::ComputeDistance(coords[stops[i - 1]], coords[stops[i]]);
+                builder.AddDistance(route[i - 1], route[i], std::max(1, static_cast<int>(length * detour(random))));
+            }
+        }
+        builder.AddBus("Bus "s + std::to_string(bus), route, true);
+    }
+    builder.Build(catalogue);
+}
+
+bool ParseRouterType(std::string_view name, router::RouterType& type) {
+    static const std::unordered_map<std::string_view, router::RouterType> types{
+        {"floyd_warshall"sv, router::RouterType::FLOYD_WARSHALL},
+        {"dijkstra"sv, router::RouterType::DIJKSTRA},
+        {"radix_dijkstra"sv, router::RouterType::RADIX_DIJKSTRA},
+        {"a_star"sv, router::RouterType::A_STAR},
+        {"contraction_hierarchy"sv, router::RouterType::CONTRACTION_HIERARCHY},
+    };
+    if (auto it = types.find(name); it != types.end()) {
+        type = it->second;
+        return true;
+    }
+    return false;
+}
+
+bool ParseGraphModel(std::string_view name, router::GraphModel& model) {
+    static const std::unordered_map<std::string_view, router::GraphModel> models{
+        {"all_spans"sv, router::GraphModel::ALL_SPANS},
+        {"ride_chains"sv, router::GraphModel::RIDE_CHAINS},
+    };
+    if (auto it = models.find(name); it != models.end()) {
+        model = it->second;
+        return true;
+    }
+    return false;
+}
+
+// те же ограничения, что проверяет json_reader
+bool IsSupported(router::RouterType type, router::GraphModel model) {
+    if (type == router::RouterType::FLOYD_WARSHALL) {
+        return model == router::GraphModel::ALL_SPANS;
+    }
+    if (type == router::RouterType::CONTRACTION_HIERARCHY) {
+        return model == router::GraphModel::RIDE_CHAINS;
+    }
+    return true;
+}
+
+router::RoutingSettings MakeSettings(router::RouterType type, router::GraphModel model, size_t thread_count = 1) {
+    router::RoutingSettings settings;
+    settings.wait_time = 6;
+    settings.velocity = 40.0 * 1000.0 / 60.0;
+    settings.router_type = type;
+    settings.thread_count = thread_count;
+    settings.graph_model = model;
+    return settings;
+}
+
+double ToMilliseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+double ToMegabytes(double bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+// Дейкстра ничего не предрассчитывает, поэтому её построение -- это построение графа
+void RunGraphBenchmark(const catalogue::TransportCatalogue& catalogue, std::string_view name, router::GraphModel model) {
+    const size_t memory_before = GetResidentMemory();
+    const auto build_start = std::chrono::steady_clock::now();
+    router::TransportRouter transport_router(MakeSettings(router::RouterType::DIJKSTRA, model), catalogue);
+    const double build_ms = ToMilliseconds(std::chrono::steady_clock::now() - build_start);
+    const size_t memory_after = GetResidentMemory();
+    
+    // рёбра графа вместе со смещениями CSR и описаниями рёбер для ответа
+    const graph::CsrGraph<double>& graph = transport_router.GetGraph();
+    const size_t edge_bytes = graph.GetEdges().size_bytes() + graph.GetOffsets().size_bytes()
+                            + transport_router.GetEdgeInfos().size() * sizeof(router::EdgeInfo);
+    std::printf("graph %-12s          vertices %8zu  edges %9zu  build %10.1f ms  memory %+8.1f MB  edges %8.1f MB\n",
+                std::string(name).c_str(), graph.GetVertexCount(), graph.GetEdgeCount(), build_ms,
+                ToMegabytes(static_cast<double>(memory_after) - static_cast<double>(memory_before)),
+                ToMegabytes(static_cast<double>(edge_bytes)));
+    std::fflush(stdout);
+}
+
+void RunBenchmark(const Options& options, const catalogue::TransportCatalogue& catalogue, std::string_view name,
+                  router::RoutingSettings settings) {
+    const size_t memory_before = GetResidentMemory();
+    const auto build_start = std::chrono::steady_clock::now();
+    router::TransportRouter transport_router(std::move(settings), catalogue);
+    const double build_ms = ToMilliseconds(std::chrono::steady_clock::now() - build_start);
+    const size_t memory_after = GetResidentMemory();
+    
+    // у всех алгоритмов одни и те же запросы
+    std::mt19937 random(options.seed + 1);
+    std::uniform_int_distribution<size_t> stop_index(0, catalogue.GetStopsData().size() - 1);
+    std::vector<double> latencies;
+    latencies.reserve(options.query_count);
+    size_t found = 0;
+    double checksum = 0.0;
+    for (size_t i = 0; i < options.query_count; ++i) {
+        const std::string_view from = catalogue.GetStopsData()[stop_index(random)].name;
+        const std::string_view to = catalogue.GetStopsData()[stop_index(random)].name;
+        
+        const auto query_start = std::chrono::steady_clock::now();
+        const auto route = transport_router.BuildRoute(from, to);
+        latencies.push_back(ToMilliseconds(std::chrono::steady_clock::now() - query_start) * 1000.0);
+        if (route) {
+            ++found;
+            checksum += route->weight;
+        }
+    }
+    
+    double mean_us = 0.0;
+    for (double latency : latencies) {
+        mean_us += latency;
+    }
+    mean_us /= std::max<size_t>(latencies.size(), 1);
+    std::sort(latencies.begin(), latencies.end());
+    const double p99_us = latencies.empty() ? 0.0 : latencies[latencies.size() * 99 / 100];
+    
+    const graph::CsrGraph<double>& graph = transport_router.GetGraph();
+    std::printf("  %-25s vertices %8zu  edges %9zu  build %10.1f ms  memory %+8.1f MB  query %9.1f us  p99 %9.1f us"
+                "  found %zu  checksum %.3f\n",
+                std::string(name).c_str(), graph.GetVertexCount(), graph.GetEdgeCount(), build_ms,
+                ToMegabytes(static_cast<double>(memory_after) - static_cast<double>(memory_before)),
+                mean_us, p99_us, found, checksum);
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        if (!ParseOptions(argc, argv, options)) {
+            PrintUsage();
+            return 1;
+        }
+    } catch (const std::exception&) {
+        PrintUsage();
+        return 1;
+    }
+    
+    catalogue::TransportCatalogue catalogue;
+    GenerateNetwork(options, catalogue);
+    std::printf("stops %zu, buses %zu of %zu-%zu stops, queries %zu\n", options.stop_count, options.bus_count,
+                options.min_bus_stops, options.max_bus_stops, options.query_count);
+    
+    for (const std::string& graph_name : options.graphs) {
+        router::GraphModel model;
+        if (!ParseGraphModel(graph_name, model)) {
+            std::cerr << "Unknown graph model "sv << graph_name << '\n';
+            return 1;
+        }
+        RunGraphBenchmark(catalogue, graph_name, model);
+        
+        for (const std::string& name : options.routers) {
+            router::RouterType type;
+            if (!ParseRouterType(name, type)) {
+                std::cerr << "Unknown router type "sv << name << '\n';
+                return 1;
+            }
+            if (!IsSupported(type, model)) {
+                std::printf("  %-25s not supported on %s\n", name.c_str(), graph_name.c_str());
+                continue;
+            }
+            if (type != router::RouterType::FLOYD_WARSHALL) {
+                RunBenchmark(options, catalogue, name, MakeSettings(type, model));
+                continue;
+            }
+            for (size_t thread_count : options.thread_counts) {
+                RunBenchmark(options, catalogue, name + " x"s + std::to_string(thread_count),
+                             MakeSettings(type, model, thread_count));
+            }
+        }
+    }
+}
@@ -5,15 +5,65 @@
 
 namespace geo {
 
+namespace {
+
+const double DR = M_PI / 180.0;
+const int EARTH_RADIUS = 6371000; // в метрах
+
+} // namespace
+
 double ComputeDistance(Coordinates from, Coordinates to) {
     using namespace std;
     
-    const double dr = M_PI / 180.0;
-    const int EARTH_RADIUS = 6371000; // в метрах
-    
-    return acos(sin(from.lat * dr) * sin(to.lat * dr)
-                + cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr))
+    return acos(sin(from.lat * DR) * sin(to.lat * DR)
+                + cos(from.lat * DR) * cos(to.lat * DR) * cos(abs(from.lng - to.lng) * DR))
+           * EARTH_RADIUS;
+}
+
+void Points::Reserve(size_t count) {
+    lat_sin_.reserve(count);
+    lat_cos_.reserve(count);
+    lng_.reserve(count);
+}
+
+void Points::Add(Coordinates coords) {
+    lat_sin_.push_back(std::sin(coords.lat * DR));
+    lat_cos_.push_back(std::cos(coords.lat * DR));
+    lng_.push_back(coords.lng);
+}
+
+void Points::Set(uint32_t index, Coordinates coords) {
+    lat_sin_[index] = std::sin(coords.lat * DR);
+    lat_cos_[index] = std::cos(coords.lat * DR);
+    lng_[index] = coords.lng;
+}
+
+double Points::ComputeDistance(uint32_t from, uint32_t to) const {
+    return std::acos(lat_sin_[from] * lat_sin_[to]
+                     + lat_cos_[from] * lat_cos_[to] * std::cos(std::abs(lng_[from] - lng_[to]) * DR))
            * EARTH_RADIUS;
 }
 
+void Points::ComputeDistances(std::span<const uint32_t> path, std::span<double> lengths) const {
+    if (path.size() < 2) {
+        return;
+    }
+    const size_t count = path.size() - 1;
+    
+    /*
+     * Проходы разделены, чтобы средний, без вызовов функций, векторизовался (AVX2, NEON);
+     * cos и acos считаются по одному значению, как и в ComputeDistance.
+     */
+    for (size_t i = 0; i < count; ++i) {
+        lengths[i] = std::cos(std::abs(lng_[path[i]] - lng_[path[i + 1]]) * DR);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t from = path[i], to = path[i + 1];
+        lengths[i] = lat_sin_[from] * lat_sin_[to] + lat_cos_[from] * lat_cos_[to] * lengths[i];
+    }
+    for (size_t i = 0; i < count; ++i) {
+        lengths[i] = std::acos(lengths[i]) * EARTH_RADIUS;
+    }
+}
+
 } // namespace geo
@@ -1,15 +1,42 @@
-#pragma once
-
-namespace geo {
-
-struct Coordinates {
-    inline bool operator==(const Coordinates& rhs) const { return lat == rhs.lat && lng == rhs.lng; }
-    inline bool operator!=(const Coordinates& rhs) const { return !(*this == rhs); }
-    
-    double lat = 0.0;
-    double lng = 0.0;
-};
-
-double ComputeDistance(Coordinates from, Coordinates to);
-
-} // namespace geo
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace geo {
+
+struct Coordinates {
+    inline bool operator==(const Coordinates& rhs) const { return lat == rhs.lat && lng == rhs.lng; }
+    inline bool operator!=(const Coordinates& rhs) const { return !(*this == rhs); }
+    
+    double lat = 0.0;
+    double lng = 0.0;
+};
+
+double ComputeDistance(Coordinates from, Coordinates to);
+
+/*
+ * Координаты набора точек, разложенные по отдельным массивам. Синус и косинус широты считаются один раз
+ * при добавлении точки, поэтому на отрезок остаются только cos разности долгот и acos. Порядок операций
+ * тот же, что в ComputeDistance, и при одинаковых флагах компиляции результат совпадает с ней до бита:
+ * допуск при сравнении нулевой.
+ */
+class Points {
+public:
+    void Reserve(size_t count);
+    void Add(Coordinates coords);
+    void Set(uint32_t index, Coordinates coords);
+    inline size_t Size() const { return lng_.size(); }
+    
+    double ComputeDistance(uint32_t from, uint32_t to) const;
+    // длины отрезков ломаной через точки с номерами path; lengths вмещает path.size() - 1 значений
+    void ComputeDistances(std::span<const uint32_t> path, std::span<double> lengths) const;
+    
+private:
+    std::vector<double> lat_sin_;
+    std::vector<double> lat_cos_;
+    std::vector<double> lng_; // в градусах, как в ComputeDistance
+};
+
+} // namespace geo
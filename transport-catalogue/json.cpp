@@ -1,6 +1,17 @@
 #include "json.h"
 
-#include <iomanip>
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdio>
+#include <iterator>
+#include <istream>
+#include <ostream>
+#include <numeric>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace std::literals;
 
@@ -23,7 +34,7 @@ bool Node::IsBool() const {
 }
 
 bool Node::IsString() const {
-    return std::holds_alternative<std::string>(GetValue());
+    return std::holds_alternative<String>(GetValue());
 }
 
 bool Node::IsNull() const {
@@ -59,11 +70,11 @@ bool Node::AsBool() const {
     return std::get<bool>(GetValue());
 }
 
-const std::string& Node::AsString() const {
+const String& Node::AsString() const {
     if (!IsString()) {
         throw std::logic_error("Node has no string"s);
     }
-    return std::get<std::string>(GetValue());
+    return std::get<String>(GetValue());
 }
 
 const Array& Node::AsArray() const {
@@ -80,11 +91,11 @@ const Dict& Node::AsMap() const {
     return std::get<Dict>(GetValue());
 }
 
-std::string& Node::AsString() {
+String& Node::AsString() {
     if (!IsString()) {
         throw std::logic_error("Node has no string"s);
     }
-    return std::get<std::string>(GetValue());
+    return std::get<String>(GetValue());
 }
 
 Array& Node::AsArray() {
@@ -101,314 +112,724 @@ Dict& Node::AsMap() {
     return std::get<Dict>(GetValue());
 }
 
-namespace detail {
-Node LoadNode(std::istream& input);
+bool Dict::operator==(const Dict& rhs) const {
+    return std::equal(items_.begin(), items_.end(), rhs.items_.begin(), rhs.items_.end());
+}
 
-Node LoadArray(std::istream& input) {
-    Array result;
-    for (char c; input >> c && c != ']';) {
-        if (c != ',') {
-            input.putback(c);
-        }
-        result.push_back(LoadNode(input));
+Dict::iterator Dict::find(std::string_view key) {
+    auto it = LowerBound(key);
+    return it != items_.end() && it->first == key ? it : items_.end();
+}
+
+Dict::const_iterator Dict::find(std::string_view key) const {
+    auto it = LowerBound(key);
+    return it != items_.end() && it->first == key ? it : items_.end();
+}
+
+Node& Dict::at(std::string_view key) {
+    if (auto it = find(key); it != items_.end()) {
+        return it->second;
+    }
+    throw std::out_of_range("No key "s + std::string(key) + " in dictionary"s);
+}
+
+const Node& Dict::at(std::string_view key) const {
+    if (auto it = find(key); it != items_.end()) {
+        return it->second;
+    }
+    throw std::out_of_range("No key "s + std::string(key) + " in dictionary"s);
+}
+
+Node& Dict::operator[](std::string_view key) {
+    return try_emplace(key, Node()).first->second;
+}
+
+std::pair<Dict::iterator, bool> Dict::try_emplace(std::string_view key, Node&& value) {
+    if (auto it = LowerBound(key); it != items_.end() && it->first == key) {
+        return {it, false};
+    } else {
+        return {items_.emplace(it, std::piecewise_construct, std::forward_as_tuple(key),
+                               std::forward_as_tuple(std::move(value))), true};
+    }
+}
+
+Dict::iterator Dict::LowerBound(std::string_view key) {
+    return std::lower_bound(items_.begin(), items_.end(), key,
+                            [](const value_type& item, std::string_view key) { return item.first < key; });
+}
+
+Dict::const_iterator Dict::LowerBound(std::string_view key) const {
+    return std::lower_bound(items_.begin(), items_.end(), key,
+                            [](const value_type& item, std::string_view key) { return item.first < key; });
+}
+
+Document::Document(Node&& root, std::unique_ptr<Arena>&& arena)
+    : arena_(std::move(arena))
+    , root_(std::pmr::polymorphic_allocator<>(arena_.get()).new_object<Node>(std::move(root)), NodeDeleter{false}) {}
+
+void NodeHandler::StartDict() {
+    StartValue();
+    frames_.push_back({values_.size(), keys_.size(), true});
+}
+
+void NodeHandler::Key(std::string_view key) {
+    if (frames_.empty() || !frames_.back().is_dict) {
+        throw ParsingError("Key "s + std::string(key) + " outside of dictionary"s);
     }
-    if (!input) {
-        throw ParsingError("Array parsing error"s);
+    if (keys_.size() - frames_.back().keys_begin != values_.size() - frames_.back().values_begin) {
+        throw ParsingError("Key "s + std::string(key) + " follows another key"s);
     }
-    return Node(move(result));
+    keys_.emplace_back(key, resource_);
 }
 
-Node LoadNull(std::istream& input) {
-    std::string s;
-    while (isalpha(input.peek())) {
-        s.push_back(input.get());
+void NodeHandler::EndDict() {
+    if (frames_.empty() || !frames_.back().is_dict) {
+        throw ParsingError("Unexpected end of dictionary"s);
+    }
+    const auto [values_begin, keys_begin, is_dict] = frames_.back();
+    const size_t size = values_.size() - values_begin;
+    if (keys_.size() - keys_begin != size) {
+        throw ParsingError("Dictionary key without value"s);
     }
     
-    if (s == "null"sv) {
-        return Node(nullptr);
-    } else {
-        throw ParsingError("Failed to parse '"s + s + "' as null"s);
+    // порядок пар задаётся сортировкой номеров: так каждая пара перемещается в словарь только один раз;
+    // при равных ключах меньший номер идёт первым, и при повторе ключа остаётся первое значение
+    order_.resize(size);
+    std::iota(order_.begin(), order_.end(), 0);
+    std::sort(order_.begin(), order_.end(), [this, keys_begin = keys_begin](size_t lhs, size_t rhs) {
+        const int cmp = keys_[keys_begin + lhs].compare(keys_[keys_begin + rhs]);
+        return cmp < 0 || (cmp == 0 && lhs < rhs);
+    });
+    
+    Dict dict(resource_);
+    dict.items_.reserve(size);
+    for (size_t i : order_) {
+        if (String& key = keys_[keys_begin + i]; dict.items_.empty() || dict.items_.back().first != key) {
+            dict.items_.emplace_back(std::move(key), std::move(values_[values_begin + i]));
+        }
     }
+    keys_.erase(keys_.begin() + keys_begin, keys_.end());
+    values_.erase(values_.begin() + values_begin, values_.end());
+    
+    frames_.pop_back();
+    AddValue(std::move(dict));
+}
+
+void NodeHandler::StartArray() {
+    StartValue();
+    frames_.push_back({values_.size(), keys_.size(), false});
 }
 
-Node LoadBool(std::istream& input) {
-    std::string s;
-    while (isalpha(input.peek())) {
-        s.push_back(input.get());
+void NodeHandler::EndArray() {
+    if (frames_.empty() || frames_.back().is_dict) {
+        throw ParsingError("Unexpected end of array"s);
     }
+    const auto values_begin = values_.begin() + frames_.back().values_begin;
+    
+    Array array(resource_);
+    array.reserve(values_.end() - values_begin);
+    std::move(values_begin, values_.end(), std::back_inserter(array));
+    values_.erase(values_begin, values_.end());
     
-    if (s == "true"sv) {
-        return Node(true);
-    } else if (s == "false"sv) {
-        return Node(false);
+    frames_.pop_back();
+    AddValue(std::move(array));
+}
+
+void NodeHandler::StringValue(std::string_view value) {
+    StartValue();
+    AddValue(String(value, resource_));
+}
+
+void NodeHandler::Value(Node::Value&& value) {
+    StartValue();
+    AddValue(Node(std::move(value)));
+}
+
+Node NodeHandler::Extract() {
+    if (!IsComplete()) {
+        throw ParsingError("Value is incomplete"s);
+    }
+    is_started_ = false;
+    
+    // корень сбрасывается, чтобы следующее значение не присваивалось поверх контейнера с другой памятью
+    Node result(std::move(root_));
+    root_ = nullptr;
+    return result;
+}
+
+void NodeHandler::StartValue() {
+    if (frames_.empty()) {
+        if (is_started_) {
+            throw ParsingError("Value is already complete"s);
+        }
+        is_started_ = true;
+    } else if (const Frame& frame = frames_.back();
+               frame.is_dict && keys_.size() - frame.keys_begin != values_.size() - frame.values_begin + 1) {
+        throw ParsingError("Dictionary value without key"s);
+    }
+}
+
+void NodeHandler::AddValue(Node&& value) {
+    if (frames_.empty()) {
+        root_ = std::move(value);
     } else {
-        throw ParsingError("Failed to parse '"s + s + "' as bool"s);
+        values_.push_back(std::move(value));
     }
 }
 
-Node LoadNumber(std::istream& input) {
-    std::string parsed_num;
+namespace detail {
+
+// источник символов из потока: каждый символ читается отдельным обращением к буферу потока
+class StreamSource {
+public:
+    explicit StreamSource(std::istream& input) : buffer_(*input.rdbuf()) {}
     
-    // Считывает в parsed_num очередной символ из input
-    auto read_char = [&parsed_num, &input] {
-        parsed_num += static_cast<char>(input.get());
-        if (!input) {
-            throw ParsingError("Number parsing error"s);
+    inline int Peek() { return buffer_.sgetc(); }
+    inline int Get() {
+        const int c = buffer_.sbumpc();
+        if (is_marked_ && c != EOF) {
+            token_.push_back(static_cast<char>(c));
         }
-    };
+        return c;
+    }
     
-    // Считывает одну или более цифр в parsed_num из input
-    auto read_digits = [&input, read_char] {
-        if (!isdigit(input.peek())) {
-            throw ParsingError("Number parsing error: a digit is expected"s);
+    int SkipSpaces() {
+        int c = Peek();
+        while (c != EOF && isspace(c)) {
+            Get();
+            c = Peek();
         }
-        while (isdigit(input.peek())) {
-            read_char();
+        return c;
+    }
+    
+    // читает символы до кавычки, обратной косой черты или перевода строки; результат живёт до следующего вызова
+    std::string_view ReadPlainChars() {
+        plain_.clear();
+        for (int c = Peek(); c != EOF && c != '"' && c != '\\' && c != '\n' && c != '\r'; c = Peek()) {
+            plain_.push_back(static_cast<char>(buffer_.sbumpc()));
         }
-    };
+        return plain_;
+    }
     
-    if (input.peek() == '-') {
-        read_char();
+    // Mark и GetMarked возвращают символы, прочитанные между их вызовами
+    inline void Mark() {
+        token_.clear();
+        is_marked_ = true;
     }
-    // Парсим целую часть числа
-    if (input.peek() == '0') {
-        read_char();
-        // После 0 в JSON не могут идти другие цифры
-    } else {
-        read_digits();
+    inline std::string_view GetMarked() {
+        is_marked_ = false;
+        return token_;
     }
     
-    bool is_int = true;
-    // Парсим дробную часть числа
-    if (input.peek() == '.') {
-        read_char();
-        read_digits();
-        is_int = false;
-    }
+private:
+    std::streambuf& buffer_;
+    bool is_marked_ = false;
+    std::string token_;
+    std::string plain_;
+};
+
+// источник символов из непрерывного буфера: длинные участки без особых символов пропускаются блоками
+class BufferSource {
+public:
+    explicit BufferSource(std::string_view input) : input_(input) {}
     
-    // Парсим экспоненциальную часть числа
-    if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-        read_char();
-        if (ch = input.peek(); ch == '+' || ch == '-') {
-            read_char();
+    inline int Peek() const { return pos_ < input_.size() ? static_cast<unsigned char>(input_[pos_]) : EOF; }
+    inline int Get() { return pos_ < input_.size() ? static_cast<unsigned char>(input_[pos_++]) : EOF; }
+    
+    int SkipSpaces() {
+        // обычно после структурного символа пробелов нет или это отступ из нескольких пробелов
+        if (pos_ < input_.size() && !isspace(static_cast<unsigned char>(input_[pos_]))) {
+            return Peek();
+        }
+#ifdef __SSE2__
+        const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t'), line_feed = _mm_set1_epi8('\n');
+        const __m128i carriage_return = _mm_set1_epi8('\r'), vertical_tab = _mm_set1_epi8('\v');
+        const __m128i form_feed = _mm_set1_epi8('\f');
+        for (; pos_ + 16 <= input_.size(); pos_ += 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input_.data() + pos_));
+            const __m128i spaces = _mm_or_si128(
+                _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+                             _mm_or_si128(_mm_cmpeq_epi8(chunk, line_feed), _mm_cmpeq_epi8(chunk, carriage_return))),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, vertical_tab), _mm_cmpeq_epi8(chunk, form_feed)));
+            if (const unsigned mask = ~_mm_movemask_epi8(spaces) & 0xFFFF; mask != 0) {
+                pos_ += std::countr_zero(mask);
+                return Peek();
+            }
         }
-        read_digits();
-        is_int = false;
+#endif
+        while (pos_ < input_.size() && isspace(static_cast<unsigned char>(input_[pos_]))) {
+            ++pos_;
+        }
+        return Peek();
     }
     
-    try {
-        if (is_int) {
-            // Сначала пробуем преобразовать строку в int
-            try {
-                return Node(stoi(parsed_num));
-            } catch (...) {
-                // В случае неудачи, например, при переполнении,
-                // код ниже попробует преобразовать строку в double
+    // читает символы до кавычки, обратной косой черты или перевода строки; результат указывает во входной буфер
+    std::string_view ReadPlainChars() {
+        const size_t begin = pos_;
+#ifdef __SSE2__
+        const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\');
+        const __m128i line_feed = _mm_set1_epi8('\n'), carriage_return = _mm_set1_epi8('\r');
+        for (; pos_ + 16 <= input_.size(); pos_ += 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input_.data() + pos_));
+            const __m128i specials = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, line_feed), _mm_cmpeq_epi8(chunk, carriage_return)));
+            if (const unsigned mask = _mm_movemask_epi8(specials); mask != 0) {
+                pos_ += std::countr_zero(mask);
+                return input_.substr(begin, pos_ - begin);
             }
         }
-        return Node(stod(parsed_num));
-    } catch (...) {
-        throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
+#endif
+        while (pos_ < input_.size() && input_[pos_] != '"' && input_[pos_] != '\\'
+               && input_[pos_] != '\n' && input_[pos_] != '\r') {
+            ++pos_;
+        }
+        return input_.substr(begin, pos_ - begin);
     }
-}
+    
+    // Mark и GetMarked возвращают символы, прочитанные между их вызовами
+    inline void Mark() { mark_ = pos_; }
+    inline std::string_view GetMarked() const { return input_.substr(mark_, pos_ - mark_); }
+    
+private:
+    std::string_view input_;
+    size_t pos_ = 0;
+    size_t mark_ = 0;
+};
 
-Node LoadString(std::istream& input) {
-    auto it = std::istreambuf_iterator<char>(input);
-    auto end = std::istreambuf_iterator<char>();
-    std::string s;
-    while (true) {
-        if (it == end) {
-            // Поток закончился до того, как встретили закрывающую кавычку?
-            throw ParsingError("String parsing error"s);
+/*
+ * Разбор не создаёт промежуточного дерева: каждое значение сразу передаётся получателю событий.
+ * Source определяет, откуда берутся символы: из потока или из непрерывного буфера.
+ */
+template <typename Source>
+class Parser {
+public:
+    Parser(Source source, Handler& handler) : source_(std::move(source)), handler_(handler) {}
+    
+    void ParseNode() {
+        switch (const int c = source_.SkipSpaces()) {
+            case '[':
+                source_.Get();
+                ParseArray();
+                break;
+            case '{':
+                source_.Get();
+                ParseDict();
+                break;
+            case '"':
+                source_.Get();
+                handler_.StringValue(ParseString());
+                break;
+            case 'n':
+            case 't':
+            case 'f':
+                ParseLiteral();
+                break;
+            case EOF:
+                throw ParsingError("Node parsing error"s);
+            default:
+                if (c != '-' && !isdigit(c)) {
+                    throw ParsingError("Unexpected character '"s + static_cast<char>(c) + "'"s);
+                }
+                ParseNumber();
         }
-        const char ch = *it;
-        if (ch == '"') {
-            // Встретили закрывающую кавычку
-            ++it;
-            break;
-        } else if (ch == '\\') {
-            // Встретили начало escape-последовательности
-            ++it;
-            if (it == end) {
-                // Поток завершился сразу после символа обратной косой черты
+    }
+    
+private:
+    void ParseArray() {
+        handler_.StartArray();
+        if (source_.SkipSpaces() == ']') {
+            source_.Get();
+        } else {
+            for (int c = ','; c != ']'; c = source_.Get()) {
+                if (c != ',') {
+                    throw ParsingError("Array parsing error"s);
+                }
+                ParseNode();
+                source_.SkipSpaces();
+            }
+        }
+        handler_.EndArray();
+    }
+    
+    void ParseDict() {
+        handler_.StartDict();
+        if (source_.SkipSpaces() == '}') {
+            source_.Get();
+        } else {
+            for (int c = ','; c != '}'; c = source_.Get()) {
+                if (c != ',') {
+                    throw ParsingError("Dictionary parsing error"s);
+                }
+                if (source_.SkipSpaces() != '"') {
+                    throw ParsingError("Dictionary parsing error: key-value pair must start with string"s);
+                }
+                source_.Get();
+                handler_.Key(ParseString());
+                
+                if (source_.SkipSpaces() != ':') {
+                    throw ParsingError("Dictionary parsing error: expected \':\' after key string"s);
+                }
+                source_.Get();
+                ParseNode();
+                source_.SkipSpaces();
+            }
+        }
+        handler_.EndDict();
+    }
+    
+    // открывающая кавычка уже прочитана; результат живёт до разбора следующей строки
+    std::string_view ParseString() {
+        // обычно escape-последовательностей нет, и строку не нужно никуда копировать
+        if (std::string_view plain = source_.ReadPlainChars(); source_.Peek() == '"') {
+            source_.Get();
+            return plain;
+        } else {
+            string_.assign(plain);
+        }
+        
+        std::string& s = string_;
+        while (true) {
+            const int ch = source_.Get();
+            if (ch == EOF) {
+                // Поток закончился до того, как встретили закрывающую кавычку?
                 throw ParsingError("String parsing error"s);
+            } else if (ch == '"') {
+                // Встретили закрывающую кавычку
+                break;
+            } else if (ch == '\\') {
+                // Встретили начало escape-последовательности; обрабатываем одну из: \\, \n, \t, \r, \"
+                switch (const int escaped_char = source_.Get()) {
+                    case 'n':
+                        s.push_back('\n');
+                        break;
+                    case 't':
+                        s.push_back('\t');
+                        break;
+                    case 'r':
+                        s.push_back('\r');
+                        break;
+                    case '"':
+                        s.push_back('"');
+                        break;
+                    case '\\':
+                        s.push_back('\\');
+                        break;
+                    case EOF:
+                        // Поток завершился сразу после символа обратной косой черты
+                        throw ParsingError("String parsing error"s);
+                    default:
+                        // Встретили неизвестную escape-последовательность
+                        throw ParsingError("String parsing error: unrecognized escape sequence \\"s
+                                           + static_cast<char>(escaped_char));
+                }
+            } else {
+                // Строковый литерал внутри JSON не может прерываться символами \r или \n
+                throw ParsingError("String parsing error: unexpected end of line"s);
             }
-            const char escaped_char = *(it);
-            // Обрабатываем одну из последовательностей: \\, \n, \t, \r, \"
-            switch (escaped_char) {
-                case 'n':
-                    s.push_back('\n');
-                    break;
-                case 't':
-                    s.push_back('\t');
-                    break;
-                case 'r':
-                    s.push_back('\r');
-                    break;
-                case '"':
-                    s.push_back('"');
-                    break;
-                case '\\':
-                    s.push_back('\\');
-                    break;
-                default:
-                    // Встретили неизвестную escape-последовательность
-                    throw ParsingError("String parsing error: unrecognized escape sequence \\"s + escaped_char);
+            s.append(source_.ReadPlainChars());
+        }
+        return s;
+    }
+    
+    void ParseLiteral() {
+        std::string s;
+        while (isalpha(source_.Peek())) {
+            s.push_back(static_cast<char>(source_.Get()));
+        }
+        
+        if (s == "null"sv) {
+            handler_.Value(nullptr);
+        } else if (s == "true"sv) {
+            handler_.Value(true);
+        } else if (s == "false"sv) {
+            handler_.Value(false);
+        } else {
+            throw ParsingError("Failed to parse '"s + s + "' as literal"s);
+        }
+    }
+    
+    void ParseNumber() {
+        // Считывает одну или более цифр
+        auto read_digits = [this] {
+            if (!isdigit(source_.Peek())) {
+                throw ParsingError("Number parsing error: a digit is expected"s);
+            }
+            while (isdigit(source_.Peek())) {
+                source_.Get();
             }
-        } else if (ch == '\n' || ch == '\r') {
-            // Строковый литерал внутри- JSON не может прерываться символами \r или \n
-            throw ParsingError("String parsing error: unexpected end of line"s);
+        };
+        
+        source_.Mark();
+        if (source_.Peek() == '-') {
+            source_.Get();
+        }
+        // Парсим целую часть числа
+        if (source_.Peek() == '0') {
+            source_.Get();
+            // После 0 в JSON не могут идти другие цифры
         } else {
-            // Просто считываем очередной символ и помещаем его в результирующую строку
-            s.push_back(ch);
+            read_digits();
         }
-        ++it;
+        
+        bool is_int = true;
+        // Парсим дробную часть числа
+        if (source_.Peek() == '.') {
+            source_.Get();
+            read_digits();
+            is_int = false;
+        }
+        
+        // Парсим экспоненциальную часть числа
+        if (int ch = source_.Peek(); ch == 'e' || ch == 'E') {
+            source_.Get();
+            if (ch = source_.Peek(); ch == '+' || ch == '-') {
+                source_.Get();
+            }
+            read_digits();
+            is_int = false;
+        }
+        
+        handler_.Value(ConvertNumber(source_.GetMarked(), is_int));
     }
-    return Node(move(s));
-}
-
-Node LoadDict(std::istream& input) {
-    Dict result;
-    for (char c; input >> c && c != '}';) {
-        if (c == '"') {
-            std::string key = LoadString(input).AsString();
-            
-            for (; input >> c && c != ':';) {}
-            if (!input) {
-                throw ParsingError("Dictionary parsing error: expected \':\' after key string"s);
+    
+    static Node::Value ConvertNumber(std::string_view parsed_num, bool is_int) {
+        const char* begin = parsed_num.data();
+        const char* end = parsed_num.data() + parsed_num.size();
+        
+        // Сначала пробуем преобразовать строку в int; при переполнении преобразуем её в double
+        if (is_int) {
+            int value;
+            if (auto [ptr, error] = std::from_chars(begin, end, value); error == std::errc() && ptr == end) {
+                return value;
             }
-            result.emplace(std::move(key), LoadNode(input));
-        } else if (c != ',') {
-            throw ParsingError("Dictionary parsing error: key-value pair must start with string"s);
         }
+        double value;
+        if (auto [ptr, error] = std::from_chars(begin, end, value); error == std::errc() && ptr == end) {
+            return value;
+        }
+        throw ParsingError("Failed to convert "s + std::string(parsed_num) + " to number"s);
     }
-    if (!input) {
-        throw ParsingError("Dictionary parsing error"s);
+    
+    Source source_;
+    Handler& handler_;
+    std::string string_;
+};
+
+} // namespace detail
+
+void Parse(std::istream& input, Handler& handler) {
+    if (!input.rdbuf()) {
+        throw ParsingError("Input stream has no buffer"s);
     }
-    return Node(move(result));
+    detail::Parser(detail::StreamSource(input), handler).ParseNode();
+}
+
+void Parse(std::string_view input, Handler& handler) {
+    detail::Parser(detail::BufferSource(input), handler).ParseNode();
+}
+
+Document Load(std::istream& input) {
+    auto arena = std::make_unique<Document::Arena>();
+    NodeHandler handler(arena.get());
+    Parse(input, handler);
+    return Document(handler.Extract(), std::move(arena));
+}
+
+Document Load(std::string_view input) {
+    auto arena = std::make_unique<Document::Arena>();
+    NodeHandler handler(arena.get());
+    Parse(input, handler);
+    return Document(handler.Extract(), std::move(arena));
 }
 
-Node LoadNode(std::istream& input) {
-    char c;
-    for (; input >> c && isspace(c);) {}
-    if (!input) {
-        throw ParsingError("Node parsing error"s);
+namespace {
+
+// буфер Writer передаётся в поток, когда набирается столько символов
+constexpr size_t WRITER_FLUSH_SIZE = 64 * 1024;
+
+} // namespace
+
+void Writer::StartDict() {
+    StartValue();
+    buffer_.push_back('{');
+    levels_.push_back({true});
+}
+
+void Writer::Key(std::string_view key) {
+    if (levels_.empty() || !levels_.back().is_dict || has_key_) {
+        throw std::logic_error("Unexpected key "s + std::string(key));
     }
-    
-    switch (c) {
-        case '[':
-            return LoadArray(input);
-        case '{':
-            return LoadDict(input);
-        case '"':
-            return LoadString(input);
-        case 'n':
-            input.putback(c);
-            return LoadNull(input);
-        case 't':
-        case 'f':
-            input.putback(c);
-            return LoadBool(input);
-        default:
-            input.putback(c);
-            return LoadNumber(input);
+    StartElement();
+    WriteString(key);
+    buffer_.append(is_compact_ ? ":"sv : ": "sv);
+    has_key_ = true;
+}
+
+void Writer::EndDict() {
+    if (levels_.empty() || !levels_.back().is_dict || has_key_) {
+        throw std::logic_error("Unexpected end of dictionary"s);
     }
+    if (!is_compact_) {
+        // пустой словарь печатается с пустой строкой внутри, как и раньше
+        buffer_.push_back('\n');
+        if (levels_.back().is_empty) {
+            buffer_.push_back('\n');
+        }
+        WriteIndent(levels_.size() - 1);
+    }
+    buffer_.push_back('}');
+    levels_.pop_back();
+    EndValue();
 }
-} // namespace detail
 
-Document Load(std::istream& input) {
-    return Document(detail::LoadNode(input));
+void Writer::StartArray() {
+    StartValue();
+    buffer_.push_back('[');
+    levels_.push_back({false});
 }
 
-class PrintContext {
-public:
-    PrintContext(std::ostream& out, int step, int indent) : out(out), step(step), indent(indent) {}
-    
-    PrintContext Indented() const { return PrintContext(out, step, step + indent); }
-    void PrintIndent() const { out << std::setw(indent) << (indent ? " "sv : ""sv); }
-    
-    void PrintNode(const Node& node) {
-        std::visit([this](const auto& value) { PrintValue(value); }, node.GetValue());
+void Writer::EndArray() {
+    if (levels_.empty() || levels_.back().is_dict) {
+        throw std::logic_error("Unexpected end of array"s);
     }
-    
-private:
-    void PrintValue(const bool value) { out << std::boolalpha << value; }
-    void PrintValue(const int value) { out << value; }
-    void PrintValue(const double value) { out << value; }
-    void PrintValue(const std::nullptr_t) { out << "null"sv; }
-    void PrintValue(const std::string& value) {
-        out << '"';
-        for (const char c : value) {
-            switch (c) {
-                case '\t':
-                    out << "\\t"sv;
-                    break;
-                case '\n':
-                    out << "\\n"sv;
-                    break;
-                case '\r':
-                    out << "\\r"sv;
-                    break;
-                case '"':
-                case '\\':
-                    out << '\\';
-                    [[fallthrough]];
-                default:
-                    out << c;
-            }
+    if (!is_compact_) {
+        buffer_.push_back('\n');
+        if (levels_.back().is_empty) {
+            buffer_.push_back('\n');
         }
-        out << '"';
+        WriteIndent(levels_.size() - 1);
     }
-    void PrintValue(const Array& value) {
-        PrintContext nested_ctx = Indented();
-        
-        out << "[\n"sv;
-        if (!value.empty()) {
-            auto it = value.begin();
-            nested_ctx.PrintIndent();
-            nested_ctx.PrintNode(*it);
-            while (++it != value.end()) {
-                out << ",\n"sv;
-                nested_ctx.PrintIndent();
-                nested_ctx.PrintNode(*it);
-            }
+    buffer_.push_back(']');
+    levels_.pop_back();
+    EndValue();
+}
+
+void Writer::StringValue(std::string_view value) {
+    StartValue();
+    WriteString(value);
+    EndValue();
+}
+
+void Writer::Value(Node::Value&& value) {
+    WriteValue(value);
+}
+
+void Writer::Write(const Node& node) {
+    WriteValue(node.GetValue());
+}
+
+void Writer::WriteValue(const Node::Value& value) {
+    if (const Array* array = std::get_if<Array>(&value)) {
+        StartArray();
+        for (const Node& node : *array) {
+            Write(node);
+        }
+        EndArray();
+    } else if (const Dict* dict = std::get_if<Dict>(&value)) {
+        StartDict();
+        for (const auto& [key, node] : *dict) {
+            Key(key);
+            Write(node);
         }
-        out << '\n';
-        PrintIndent();
-        out << ']';
+        EndDict();
+    } else if (const String* string = std::get_if<String>(&value)) {
+        StringValue(*string);
+    } else {
+        StartValue();
+        char chars[32];
+        char* end = chars;
+        if (const int* number = std::get_if<int>(&value)) {
+            end = std::to_chars(chars, chars + sizeof(chars), *number).ptr;
+        } else if (const double* number = std::get_if<double>(&value)) {
+            // совпадает с выводом double в std::ostream по умолчанию: %g с точностью 6
+            end = std::to_chars(chars, chars + sizeof(chars), *number, std::chars_format::general, 6).ptr;
+        } else if (const bool* flag = std::get_if<bool>(&value)) {
+            buffer_.append(*flag ? "true"sv : "false"sv);
+        } else {
+            buffer_.append("null"sv);
+        }
+        buffer_.append(chars, end);
+        EndValue();
     }
-    void PrintValue(const Dict& value) {
-        PrintContext nested_ctx = Indented();
+}
+
+void Writer::WriteString(std::string_view value) {
+    buffer_.push_back('"');
+    // участки без особых символов копируются целиком
+    for (size_t pos = 0; pos < value.size();) {
+        const size_t special = value.find_first_of("\t\n\r\"\\"sv, pos);
+        buffer_.append(value.substr(pos, special - pos));
+        if (special == std::string_view::npos) {
+            break;
+        }
         
-        out << "{\n"sv;
-        if (!value.empty()) {
-            auto it = value.begin();
-            nested_ctx.PrintIndent();
-            nested_ctx.PrintValue(it->first); // std::string
-            out << ": "sv;
-            nested_ctx.PrintNode(it->second); // Node
-            while (++it != value.end()) {
-                out << ",\n"sv;
-                nested_ctx.PrintIndent();
-                nested_ctx.PrintValue(it->first);
-                out << ": "sv;
-                nested_ctx.PrintNode(it->second);
-            }
+        buffer_.push_back('\\');
+        switch (const char c = value[special]) {
+            case '\t':
+                buffer_.push_back('t');
+                break;
+            case '\n':
+                buffer_.push_back('n');
+                break;
+            case '\r':
+                buffer_.push_back('r');
+                break;
+            default:
+                buffer_.push_back(c);
         }
-        out << '\n';
-        PrintIndent();
-        out << '}';
+        pos = special + 1;
     }
+    buffer_.push_back('"');
+}
+
+void Writer::WriteIndent(size_t depth) {
+    buffer_.append(indent_ + depth * step_, ' ');
+}
+
+void Writer::StartElement() {
+    Level& level = levels_.back();
+    if (!level.is_empty) {
+        buffer_.push_back(',');
+    }
+    level.is_empty = false;
     
-    std::ostream& out;
-    int step;
-    int indent;
-};
+    if (!is_compact_) {
+        buffer_.push_back('\n');
+        WriteIndent(levels_.size());
+    }
+}
+
+void Writer::StartValue() {
+    if (levels_.empty()) {
+        return;
+    }
+    if (levels_.back().is_dict) {
+        if (!has_key_) {
+            throw std::logic_error("Dictionary value without key"s);
+        }
+        has_key_ = false;
+    } else {
+        StartElement();
+    }
+}
+
+void Writer::EndValue() {
+    if (levels_.empty()) {
+        buffer_.push_back('\n');
+        Flush();
+    } else if (buffer_.size() >= WRITER_FLUSH_SIZE) {
+        Flush();
+    }
+}
+
+void Writer::Flush() {
+    output_.write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+}
 
 void Print(const Document& doc, std::ostream& output, int step, int indent) {
-    PrintContext ctx(output, step, indent);
-    ctx.PrintNode(doc.GetRoot());
-    output << '\n';
+    Writer(output, step, indent).Write(doc.GetRoot());
 }
 
 }  // namespace json
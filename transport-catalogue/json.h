@@ -1,16 +1,72 @@
 #pragma once
 
-#include <map>
+#include <memory>
+#include <memory_resource>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
 namespace json {
 
+/*
+ * Строки и контейнеры берут память из std::pmr::memory_resource. Разобранный документ размещается
+ * целиком в своей арене, а узлы, созданные вручную, по умолчанию используют обычную кучу.
+ */
 class Node;
-using Array = std::vector<Node>;
-using Dict = std::map<std::string, Node>;
+using String = std::pmr::string;
+using Array = std::pmr::vector<Node>;
+
+/*
+ * Словарь хранит пары в векторе, отсортированном по ключу: словари в запросах маленькие, и поиск
+ * по непрерывному массиву быстрее обхода дерева, а узлов дерева не нужно выделять по одному.
+ * Искать можно по любой строке, приводимой к std::string_view, без создания временного ключа.
+ */
+class Dict {
+public:
+    using value_type = std::pair<String, Node>;
+    using allocator_type = std::pmr::polymorphic_allocator<value_type>;
+    using iterator = std::pmr::vector<value_type>::iterator;
+    using const_iterator = std::pmr::vector<value_type>::const_iterator;
+    
+    Dict() = default;
+    explicit Dict(const allocator_type& allocator) : items_(allocator) {}
+    
+    bool operator==(const Dict& rhs) const;
+    inline bool operator!=(const Dict& rhs) const { return !(*this == rhs); }
+    
+    // тела коротких методов вынесены за определение Node: до него тип пары ещё неполон
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+    
+    size_t size() const;
+    bool empty() const;
+    
+    iterator find(std::string_view key);
+    const_iterator find(std::string_view key) const;
+    size_t count(std::string_view key) const;
+    
+    // как и у std::map, at бросает std::out_of_range, а operator[] добавляет отсутствующий ключ
+    Node& at(std::string_view key);
+    const Node& at(std::string_view key) const;
+    Node& operator[](std::string_view key);
+    
+    // добавляет значение, только если такого ключа ещё нет
+    std::pair<iterator, bool> try_emplace(std::string_view key, Node&& value);
+    
+private:
+    // разобранный словарь собирается сразу упорядоченным, без поиска места для каждой пары
+    friend class NodeHandler;
+    
+    iterator LowerBound(std::string_view key);
+    const_iterator LowerBound(std::string_view key) const;
+    
+    std::pmr::vector<value_type> items_;
+};
 
 // Эта ошибка должна выбрасываться при ошибках парсинга JSON
 class ParsingError : public std::runtime_error {
@@ -18,13 +74,14 @@ public:
     using runtime_error::runtime_error;
 };
 
-class Node final : std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string> {
+class Node final : std::variant<std::nullptr_t, Array, Dict, bool, int, double, String> {
 public:
     using variant::variant;
     using Value = variant;
     
     explicit Node(Value&& value) : variant(std::move(value)) {}
-    explicit Node(std::string_view sv) : variant(std::string(sv)) {}
+    explicit Node(std::string_view sv) : variant(String(sv)) {}
+    Node(const std::string& s) : variant(String(s)) {}
     
     inline bool operator==(const Node& rhs) const { return GetValue() == rhs.GetValue(); }
     inline bool operator!=(const Node& rhs) const { return !(*this == rhs); }
@@ -44,28 +101,164 @@ public:
     int AsInt() const;
     double AsDouble() const;
     bool AsBool() const;
-    const std::string& AsString() const;
+    const String& AsString() const;
     const Array& AsArray() const;
     const Dict& AsMap() const;
-    std::string& AsString();
+    String& AsString();
     Array& AsArray();
     Dict& AsMap();
 };
 
+inline Dict::iterator Dict::begin() { return items_.begin(); }
+inline Dict::iterator Dict::end() { return items_.end(); }
+inline Dict::const_iterator Dict::begin() const { return items_.begin(); }
+inline Dict::const_iterator Dict::end() const { return items_.end(); }
+inline size_t Dict::size() const { return items_.size(); }
+inline bool Dict::empty() const { return items_.empty(); }
+inline size_t Dict::count(std::string_view key) const { return find(key) != end() ? 1 : 0; }
+
 class Document {
 public:
-    explicit Document(Node&& root) : root_(std::move(root)) {}
+    using Arena = std::pmr::monotonic_buffer_resource;
     
-    inline bool operator==(const Document& rhs) const { return root_ == rhs.root_; }
+    explicit Document(Node&& root) : root_(new Node(std::move(root)), NodeDeleter{true}) {}
+    // все строки и контейнеры root должны быть размещены в arena
+    Document(Node&& root, std::unique_ptr<Arena>&& arena);
+    
+    inline bool operator==(const Document& rhs) const { return *root_ == *rhs.root_; }
     inline bool operator!=(const Document& rhs) const { return !(*this == rhs); }
     
-    inline const Node& GetRoot() const { return root_; }
+    inline const Node& GetRoot() const { return *root_; }
+    
+private:
+    // деревья из арены не разрушаются по узлам: их память освобождается вместе с ареной за O(1)
+    struct NodeDeleter {
+        void operator()(Node* node) const {
+            if (owns_node) {
+                delete node;
+            }
+        }
+        
+        bool owns_node;
+    };
+    
+    std::unique_ptr<Arena> arena_;
+    std::unique_ptr<Node, NodeDeleter> root_;
+};
+
+/*
+ * Получатель событий потокового разбора JSON. Словари и массивы передаются парами Start/End,
+ * ключ словаря -- событием Key перед значением, строки -- событием StringValue, остальные значения --
+ * событием Value. Ключи и строки действительны только до следующего события.
+ */
+class Handler {
+public:
+    virtual ~Handler() = default;
+    
+    virtual void StartDict() = 0;
+    virtual void Key(std::string_view key) = 0;
+    virtual void EndDict() = 0;
+    virtual void StartArray() = 0;
+    virtual void EndArray() = 0;
+    virtual void StringValue(std::string_view value) = 0;
+    virtual void Value(Node::Value&& value) = 0;
+};
+
+// собирает из событий разбора узел; годится и для всего документа, и для отдельного значения в потоке
+class NodeHandler final : public Handler {
+public:
+    // все строки и контейнеры собранного узла размещаются в resource
+    explicit NodeHandler(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : resource_(resource) {}
+    
+    void StartDict() override;
+    void Key(std::string_view key) override;
+    void EndDict() override;
+    void StartArray() override;
+    void EndArray() override;
+    void StringValue(std::string_view value) override;
+    void Value(Node::Value&& value) override;
+    
+    // значение собрано целиком: получено хотя бы одно событие и все словари и массивы закрыты
+    inline bool IsComplete() const { return is_started_ && frames_.empty(); }
+    Node Extract();
     
 private:
+    // незакрытый словарь или массив: его элементы копятся на стеках values_ и keys_ начиная с этих позиций,
+    // а сам контейнер создаётся при закрытии сразу нужного размера
+    struct Frame {
+        size_t values_begin;
+        size_t keys_begin;
+        bool is_dict;
+    };
+    
+    void StartValue();
+    void AddValue(Node&& value);
+    
+    std::pmr::memory_resource* resource_;
     Node root_;
+    bool is_started_ = false;
+    std::vector<Frame> frames_;
+    std::vector<Node> values_;
+    std::vector<String> keys_;
+    std::vector<size_t> order_;
 };
 
+// разбирает одно значение JSON из input, сообщая о его частях handler по мере чтения
+void Parse(std::istream& input, Handler& handler);
+// то же для входных данных, целиком лежащих в памяти (например, в отображённом файле): это заметно быстрее
+void Parse(std::string_view input, Handler& handler);
+
+// документы, прочитанные Load, размещаются в собственной арене
 Document Load(std::istream& input);
+Document Load(std::string_view input);
+
+/*
+ * Записывает JSON по событиям Handler, не требуя готового дерева. Текст формируется в собственном
+ * буфере и передаётся в поток кусками, а законченное значение верхнего уровня сразу завершается
+ * переводом строки и сбрасывается в поток. Неверный порядок событий -- ошибка программы (std::logic_error).
+ */
+class Writer final : public Handler {
+public:
+    // компактный вывод: без пробелов и переводов строк внутри значения
+    explicit Writer(std::ostream& output) : output_(output), is_compact_(true) {}
+    // вывод с отступами: step -- шаг отступа вложенных элементов, indent -- отступ самого значения
+    Writer(std::ostream& output, int step, int indent) : output_(output), step_(step), indent_(indent) {}
+    
+    void StartDict() override;
+    void Key(std::string_view key) override;
+    void EndDict() override;
+    void StartArray() override;
+    void EndArray() override;
+    void StringValue(std::string_view value) override;
+    void Value(Node::Value&& value) override;
+    
+    // записывает готовый узел целиком
+    void Write(const Node& node);
+    
+private:
+    // открытый словарь или массив
+    struct Level {
+        bool is_dict;
+        bool is_empty = true;
+    };
+    
+    void WriteValue(const Node::Value& value);
+    void WriteString(std::string_view value);
+    void WriteIndent(size_t depth);
+    void StartElement();
+    void StartValue();
+    void EndValue();
+    void Flush();
+    
+    std::ostream& output_;
+    bool is_compact_ = false;
+    int step_ = 0;
+    int indent_ = 0;
+    std::vector<Level> levels_;
+    bool has_key_ = false;
+    std::string buffer_;
+};
 
 void Print(const Document& doc, std::ostream& output, int step, int indent);
 
@@ -1,109 +1,269 @@
 #include "json_builder.h"
 #include "json_reader.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <sstream>
+#include <thread>
 
 using namespace std::literals;
 using namespace catalogue;
 
 namespace json {
 
+namespace {
+
+// столько запросов подряд обрабатывает один поток, прежде чем взять следующие
+constexpr size_t STAT_CHUNK_SIZE = 32;
+
+} // namespace
+
 void JsonReader::ProcessBaseRequests() {
-    const Array& requests = input_.GetRoot().AsMap().at("base_requests"s).AsArray();
+    // строитель сам разрешает ссылки на остановки, описанные ниже по массиву, поэтому хватает одного прохода
+    TransportCatalogue::Builder builder;
+    for (const Node& request : input_.GetRoot().AsMap().at("base_requests").AsArray()) {
+        AddBaseRequest(request.AsMap(), builder);
+    }
+    builder.Build(GetMutableCatalogue());
+}
+
+void JsonReader::ApplyBaseRequests(const Array& requests, TransportCatalogue& catalogue) {
+    // расстояния и маршруты могут ссылаться на новые остановки, поэтому остановки идут первым проходом
+    for (const Node& node : requests) {
+        const Dict& request = node.AsMap();
+        if (request.at("type").AsString() != "Stop"sv) {
+            continue;
+        }
+        std::string_view name = request.at("name").AsString();
+        if (catalogue.GetStop(name)) {
+            catalogue.UpdateStop(name, ParseCoordinates(request));
+        } else {
+            catalogue.AddStop(name, ParseCoordinates(request));
+        }
+    }
+    for (const Node& node : requests) {
+        const Dict& request = node.AsMap();
+        if (request.at("type").AsString() != "Stop"sv) {
+            continue;
+        }
+        std::string_view name = request.at("name").AsString();
+        for (const auto& /* String, Node */ [destination, distance] : request.at("road_distances").AsMap()) {
+            catalogue.UpdateDistance(name, destination, distance.AsInt());
+        }
+    }
+    for (const Node& node : requests) {
+        const Dict& request = node.AsMap();
+        if (request.at("type").AsString() != "Bus"sv) {
+            continue;
+        }
+        std::string_view name = request.at("name").AsString();
+        if (catalogue.GetBus(name)) {
+            catalogue.UpdateBus(name, ParseRoute(request), request.at("is_roundtrip").AsBool());
+        } else {
+            catalogue.AddBus(name, ParseRoute(request), request.at("is_roundtrip").AsBool());
+        }
+    }
+}
+
+/*
+ * Запросы из base_requests собираются в дерево по одному и сразу передаются строителю справочника,
+ * который хранит их в компактном виде. Расстояния и маршруты могут ссылаться на остановки, которые
+ * встретятся позже, поэтому справочник строится целиком после чтения всего массива.
+ */
+class JsonReader::BaseRequestsHandler final : public Handler {
+public:
+    explicit BaseRequestsHandler(TransportCatalogue& catalogue) : catalogue_(catalogue) {}
+    BaseRequestsHandler(const BaseRequestsHandler&) = delete;
+    BaseRequestsHandler& operator=(const BaseRequestsHandler&) = delete;
     
-    // запомним отложенные запросы, чтобы не итерировать по всему массиву на каждом этапе
-    std::vector<uint> distances, buses;
-    distances.reserve(requests.size());
-    buses.reserve(requests.size());
+    void StartDict() override {
+        if (!value_ && depth_ == Depth::NONE) {
+            depth_ = Depth::ROOT;
+        } else {
+            Dispatch([](NodeHandler& handler) { handler.StartDict(); });
+        }
+    }
     
-    // сначала инициализируем остановки...
-    for (uint id = 0; id < requests.size(); ++id) {
-        const Dict& request = requests[id].AsMap();
-        std::string_view type = request.at("type"s).AsString();
-        
-        if (type == "Stop"sv) {
-            catalogue_.AddStop(request.at("name"s).AsString(), ParseCoordinates(request));
-            if (!request.at("road_distances"s).AsMap().empty()) {
-                distances.push_back(id);
-            }
-        } else if (type == "Bus"sv) {
-            buses.push_back(id);
+    void Key(std::string_view key) override {
+        if (value_) {
+            value_->Key(key);
+        } else {
+            key_ = key;
         }
     }
     
-    // ...затем расстояния между ними...
-    for (uint id : distances) {
-        const Dict& request = requests[id].AsMap();
-        for (const auto& /* <std::pair<std::string_view, int>> */ [destination, distance] : ParseDistances(request)) {
-            catalogue_.AddDistance(request.at("name"s).AsString(), destination, distance);
+    void EndDict() override {
+        if (!value_ && depth_ == Depth::ROOT) {
+            depth_ = Depth::NONE;
+        } else {
+            Dispatch([](NodeHandler& handler) { handler.EndDict(); });
         }
     }
     
-    // ...потом маршруты
-    for (uint id : buses) {
-        const Dict& request = requests[id].AsMap();
-        catalogue_.AddBus(request.at("name"s).AsString(), ParseRoute(request), request.at("is_roundtrip"s).AsBool());
+    void StartArray() override {
+        if (!value_ && depth_ == Depth::ROOT && key_ == "base_requests"sv) {
+            depth_ = Depth::BASE_REQUESTS;
+        } else {
+            Dispatch([](NodeHandler& handler) { handler.StartArray(); });
+        }
     }
+    
+    void EndArray() override {
+        if (!value_ && depth_ == Depth::BASE_REQUESTS) {
+            depth_ = Depth::ROOT;
+        } else {
+            Dispatch([](NodeHandler& handler) { handler.EndArray(); });
+        }
+    }
+    
+    void StringValue(std::string_view value) override {
+        Dispatch([value](NodeHandler& handler) { handler.StringValue(value); });
+    }
+    
+    void Value(Node::Value&& value) override {
+        Dispatch([&value](NodeHandler& handler) { handler.Value(std::move(value)); });
+    }
+    
+    // строит справочник и возвращает остальные разделы входных данных
+    Document Finish() {
+        builder_.Build(catalogue_);
+        return Document(Node(std::move(sections_)), std::move(arena_));
+    }
+    
+private:
+    enum class Depth { NONE, ROOT, BASE_REQUESTS };
+    
+    // передаёт событие собираемому значению и разбирает значение, как только оно собрано целиком
+    template <typename Event>
+    void Dispatch(Event event) {
+        if (!value_) {
+            if (depth_ == Depth::NONE) {
+                throw ParsingError("Input must be a dictionary"s);
+            }
+            value_ = depth_ == Depth::BASE_REQUESTS ? &request_handler_ : &section_handler_;
+        }
+        
+        event(*value_);
+        if (value_->IsComplete()) {
+            if (value_ == &request_handler_) {
+                {
+                    Node request = request_handler_.Extract();
+                    JsonReader::AddBaseRequest(request.AsMap(), builder_);
+                }
+                // память разобранного запроса больше не нужна, следующий запрос займёт её заново
+                request_arena_.release();
+            } else {
+                sections_.try_emplace(String(key_, arena_.get()), section_handler_.Extract());
+            }
+            value_ = nullptr;
+        }
+    }
+    
+    static constexpr size_t REQUEST_BUFFER_SIZE = 64 * 1024;
+    
+    TransportCatalogue& catalogue_;
+    TransportCatalogue::Builder builder_;
+    
+    Depth depth_ = Depth::NONE;
+    std::string key_;
+    NodeHandler* value_ = nullptr;
+    
+    // остальные разделы попадают в арену возвращаемого документа...
+    std::unique_ptr<Document::Arena> arena_ = std::make_unique<Document::Arena>();
+    NodeHandler section_handler_{arena_.get()};
+    Dict sections_{arena_.get()};
+    
+    // ...а запросы из base_requests по очереди собираются в одном и том же буфере
+    std::vector<std::byte> request_buffer_ = std::vector<std::byte>(REQUEST_BUFFER_SIZE);
+    std::pmr::monotonic_buffer_resource request_arena_{request_buffer_.data(), request_buffer_.size()};
+    NodeHandler request_handler_{&request_arena_};
+};
+
+Document JsonReader::ProcessBaseRequests(std::istream& input, TransportCatalogue& catalogue) {
+    BaseRequestsHandler handler(catalogue);
+    Parse(input, handler);
+    return handler.Finish();
+}
+
+Document JsonReader::ProcessBaseRequests(std::string_view input, TransportCatalogue& catalogue) {
+    BaseRequestsHandler handler(catalogue);
+    Parse(input, handler);
+    return handler.Finish();
+}
+
+void JsonReader::SerializeBase() {
+    const Dict& root = input_.GetRoot().AsMap();
+    
+    // маршрутизатор строится заранее, чтобы сохранить в снимок уже готовые граф и таблицу маршрутов
+    if (auto it = root.find("routing_settings"sv); it != root.end()) {
+        router_ = std::make_unique<router::TransportRouter>(ParseRouteSettings(it->second.AsMap()), catalogue_);
+    }
+    if (root.count("render_settings"sv)) {
+        GetRenderSettings();
+    }
+    
+    serialization::Save(GetSnapshotPath(), catalogue_, render_settings_ ? &*render_settings_ : nullptr, router_.get());
+}
+
+void JsonReader::DeserializeBase() {
+    snapshot_ = std::make_unique<io::MappedFile>(GetSnapshotPath());
+    
+    serialization::Base base = serialization::Load(*snapshot_, GetMutableCatalogue());
+    render_settings_ = std::move(base.render_settings);
+    router_ = std::move(base.router);
 }
 
 void JsonReader::PrintStats(int step, int indent) {
-    json::Print(ProcessStatRequests(), output_, step, indent);
+    Writer writer(output_, step, indent);
+    ProcessStatRequests(writer);
+}
+
+void JsonReader::PrintCompactStats() {
+    Writer writer(output_);
+    ProcessStatRequests(writer);
 }
 
 void JsonReader::RenderMap(int step, int indent) {
-    render::MapRenderer i(ParseRenderSettings(input_.GetRoot().AsMap().at("render_settings"s).AsMap()), catalogue_);
+    render::MapRenderer i(render::RenderSettings(GetRenderSettings()), catalogue_);
     i.RenderMap(output_, step, indent);
 }
 
-const Document JsonReader::ProcessStatRequests() {
-    const Array& requests = input_.GetRoot().AsMap().at("stat_requests"s).AsArray();
+void JsonReader::ProcessStatRequests(Writer& writer) {
+    const Array& requests = input_.GetRoot().AsMap().at("stat_requests").AsArray();
     
-    // вспомогательные объекты будут инициализироваться только если поступит соответствующий запрос
-    MapRenderer renderer(nullptr);
-    TransportRouter router(nullptr);
-    
-    Array response;
-    response.reserve(requests.size());
-    for (const Node& request : requests) {
-        std::string_view type = request.AsMap().at("type"s).AsString();
-        if (type == "Bus"sv) {
-            response.push_back(MakeBusResponse(request.AsMap()));
-        } else if (type == "Stop"sv) {
-            response.push_back(MakeStopResponse(request.AsMap()));
-        } else if (type == "Map"sv) {
-            if (!renderer.get()) {
-                const Dict& settings = input_.GetRoot().AsMap().at("render_settings"s).AsMap();
-                renderer = std::make_unique<render::MapRenderer>(ParseRenderSettings(settings), catalogue_);
-            }
-            response.push_back(MakeMapResponse(request.AsMap(), renderer));
-        } else if (type == "Route"sv) {
-            if (!router.get()) {
-                const Dict& settings = input_.GetRoot().AsMap().at("routing_settings"s).AsMap();
-                router = std::make_unique<router::TransportRouter>(ParseRouteSettings(settings), catalogue_);
+    writer.StartArray();
+    // потоков не больше, чем частей, на которые делятся запросы
+    if (const size_t thread_count = std::min(GetStatThreadCount(), (requests.size() + STAT_CHUNK_SIZE - 1) / STAT_CHUNK_SIZE);
+            thread_count > 1) {
+        ProcessStatRequests(requests, writer, thread_count);
+    } else {
+        for (const Node& request : requests) {
+            if (Node response = MakeResponse(request.AsMap()); !response.IsNull()) {
+                writer.Write(response);
             }
-            response.push_back(MakeRouteResponse(request.AsMap(), router));
         }
     }
-    return Document(Node(response));
+    writer.EndArray();
     
     /* нельзя объявить ctx как Builder::ArrayContext потому что он приватный, но как auto можно -- гениально
     Builder builder = json::Builder();
     auto ctx = builder.StartArray();
     for (const Node& request : requests) {
-        std::string_view type = request.AsMap().at("type"s).AsString();
+        std::string_view type = request.AsMap().at("type").AsString();
         if (type == "Bus"sv) {
             ctx.Value(MakeBusResponse(request.AsMap()));
         } else if (type == "Stop"sv) {
             ctx.Value(MakeStopResponse(request.AsMap()));
         } else if (type == "Map"sv) {
             if (!renderer.get()) {
-                const Dict& settings = input_.GetRoot().AsMap().at("render_settings"s).AsMap();
+                const Dict& settings = input_.GetRoot().AsMap().at("render_settings").AsMap();
                 renderer = std::make_unique<render::MapRenderer>(ParseRenderSettings(settings), catalogue_);
             }
             ctx.Value(MakeMapResponse(request.AsMap(), renderer));
         } else if (type== "Route"sv) {
             if (!router.get()) {
-                const Dict& settings = input_.GetRoot().AsMap().at("routing_settings"s).AsMap();
+                const Dict& settings = input_.GetRoot().AsMap().at("routing_settings").AsMap();
                 router = std::make_unique<router::TransportRouter>(ParseRouteSettings(settings), catalogue_);
             }
             ctx.Value(MakeRouteResponse(request.AsMap(), router));
@@ -113,95 +273,177 @@ const Document JsonReader::ProcessStatRequests() {
     */
 }
 
+void JsonReader::ProcessStatRequests(const Array& requests, Writer& writer, size_t thread_count) {
+    const size_t chunk_count = (requests.size() + STAT_CHUNK_SIZE - 1) / STAT_CHUNK_SIZE;
+    std::vector<Node> responses(requests.size());
+    std::vector<std::exception_ptr> errors(chunk_count);
+    std::vector<std::atomic<bool>> is_ready(chunk_count);
+    std::atomic<size_t> next_chunk = 0;
+    std::atomic<bool> is_cancelled = false;
+    
+    // запросы разбираются потоками по частям: долгие запросы маршрутов не задерживают остальные потоки
+    auto process_chunks = [&] {
+        for (size_t chunk; !is_cancelled && (chunk = next_chunk.fetch_add(1)) < chunk_count;) {
+            try {
+                for (size_t i = chunk * STAT_CHUNK_SIZE; i < std::min((chunk + 1) * STAT_CHUNK_SIZE, requests.size()); ++i) {
+                    responses[i] = MakeResponse(requests[i].AsMap());
+                }
+            } catch (...) {
+                errors[chunk] = std::current_exception();
+            }
+            is_ready[chunk].store(true, std::memory_order_release);
+            is_ready[chunk].notify_one();
+        }
+    };
+    
+    std::vector<std::jthread> workers;
+    workers.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers.emplace_back(process_chunks);
+    }
+    
+    // готовые части выводятся по порядку, и их ответы сразу освобождаются
+    try {
+        for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+            is_ready[chunk].wait(false, std::memory_order_acquire);
+            if (errors[chunk]) {
+                std::rethrow_exception(errors[chunk]);
+            }
+            for (size_t i = chunk * STAT_CHUNK_SIZE; i < std::min((chunk + 1) * STAT_CHUNK_SIZE, requests.size()); ++i) {
+                if (!responses[i].IsNull()) {
+                    writer.Write(responses[i]);
+                    responses[i] = nullptr;
+                }
+            }
+        }
+    } catch (...) {
+        // потоки доделают текущие части и завершатся при разрушении workers
+        is_cancelled = true;
+        throw;
+    }
+}
+
+Node JsonReader::MakeResponse(const Dict& request) {
+    std::string_view type = request.at("type").AsString();
+    if (type == "Bus"sv) {
+        return MakeBusResponse(request);
+    } else if (type == "Stop"sv) {
+        return MakeStopResponse(request);
+    } else if (type == "Map"sv) {
+        return MakeMapResponse(request);
+    } else if (type == "Route"sv) {
+        return MakeRouteResponse(request);
+    }
+    return nullptr;
+}
+
 Dict JsonReader::MakeBusResponse(const Dict& request) {
     Dict response;
-    if (const Bus* bus = catalogue_.GetBus(request.at("name"s).AsString())) {
-        double route_length = static_cast<double>(catalogue_.CalculateRouteLength(bus));
+    if (const Bus* bus = catalogue_.GetBus(request.at("name").AsString())) {
+        const BusStats& stats = catalogue_.GetBusStats(bus);
         
-        response["request_id"s] = request.at("id"s).AsInt();
-        response["stop_count"s] = static_cast<int>(bus->route.size());
-        response["unique_stop_count"s] = catalogue_.CountUniqueStops(bus);
-        response["route_length"s] = route_length;
-        response["curvature"s] = route_length / catalogue_.CalculateRouteGeoLength(bus);
+        response["request_id"] = request.at("id").AsInt();
+        response["stop_count"] = stats.stop_count;
+        response["unique_stop_count"] = stats.unique_stop_count;
+        response["route_length"] = static_cast<double>(stats.route_length);
+        response["curvature"] = stats.curvature;
     } else {
-        response["request_id"s] = request.at("id"s).AsInt();
-        response["error_message"s] = "not found"s;
+        response["request_id"] = request.at("id").AsInt();
+        response["error_message"] = "not found"s;
     }
     return response;
 }
 
 Dict JsonReader::MakeStopResponse(const Dict& request) {
     Dict response;
-    if (const Stop* stop = catalogue_.GetStop(request.at("name"s).AsString())) {
-        Array buses(stop->passing_buses.begin(), stop->passing_buses.end());
+    if (const Stop* stop = catalogue_.GetStop(request.at("name").AsString())) {
+        // номера идут в порядке добавления автобусов, а ответ упорядочен по названиям
+        const std::deque<Bus>& all_buses = catalogue_.GetBusesData();
+        std::vector<std::string_view> names;
+        names.reserve(stop->passing_buses.size());
+        for (BusId bus : stop->passing_buses) {
+            names.push_back(all_buses[bus].name);
+        }
+        std::sort(names.begin(), names.end());
         
-        response["request_id"s] = request.at("id"s).AsInt();
-        response["buses"s] = std::move(buses);
+        Array buses;
+        buses.reserve(names.size());
+        for (std::string_view name : names) {
+            buses.emplace_back(name);
+        }
+        
+        response["request_id"] = request.at("id").AsInt();
+        response["buses"] = std::move(buses);
     } else {
-        response["request_id"s] = request.at("id"s).AsInt();
-        response["error_message"s] = "not found"s;
+        response["request_id"] = request.at("id").AsInt();
+        response["error_message"] = "not found"s;
     }
     return response;
 }
 
-Dict JsonReader::MakeMapResponse(const Dict& request, const MapRenderer& renderer) {
-    std::ostringstream oss;
-    renderer->RenderMap(oss, 0, 4);
-    
+Dict JsonReader::MakeMapResponse(const Dict& request) {
     Dict response;
-    response["request_id"s] = request.at("id"s).AsInt();
-    response["map"s] = std::move(*oss.rdbuf()).str();
+    response["request_id"] = request.at("id").AsInt();
+    response["map"] = GetMap();
     return response;
 }
 
-Dict JsonReader::MakeRouteResponse(const Dict& request, const TransportRouter& router) {
+Dict JsonReader::MakeRouteResponse(const Dict& request) {
     Dict response;
-    if (std::optional<router::TransportRouter::RouteResponse> route_info =
-            router->BuildRoute(request.at("from"s).AsString(), request.at("to"s).AsString())) {
+    // как и в запросах Bus и Stop, неизвестное название -- это ответ "not found", а не ошибка маршрутизатора
+    std::string_view from = request.at("from").AsString(), to = request.at("to").AsString();
+    std::optional<router::TransportRouter::RouteResponse> route_info;
+    if (catalogue_.GetStop(from) && catalogue_.GetStop(to)) {
+        route_info = GetRouter().BuildRoute(from, to);
+    }
+    if (route_info) {
         Array items;
-        for (auto it = route_info->response_items.begin(); it != route_info->response_items.end(); ++it) {
-            std::visit([&items](const auto& item) {
-                Dict result;
-                result["type"s] = item.type;
-                if constexpr (std::is_same_v<std::decay_t<decltype(item)>, router::WaitResponse>) {
-                    result["stop_name"s] = std::string(item.stop);
-                } else if constexpr (std::is_same_v<std::decay_t<decltype(item)>, router::BusResponse>) {
-                    result["bus"s] = std::string(item.bus);
-                    result["span_count"s] = item.span;
-                }
-                result["time"s] = item.time;
-                
-                items.push_back(std::move(result));
-            }, *it);
+        items.reserve(route_info->response_items.size());
+        for (const router::ResponseItem& item : route_info->response_items) {
+            Dict result;
+            if (item.kind == router::EdgeKind::WAIT) {
+                result["type"] = "Wait"s;
+                result["stop_name"] = std::string(catalogue_.GetStopsData()[item.index].name);
+            } else {
+                result["type"] = "Bus"s;
+                result["bus"] = std::string(catalogue_.GetBusesData()[item.index].name);
+                result["span_count"] = item.span;
+            }
+            result["time"] = item.time;
+            
+            items.push_back(std::move(result));
         }
         
-        response["request_id"s] = request.at("id"s).AsInt();
-        response["total_time"s] = route_info->weight;
-        response["items"s] = std::move(items);
+        response["request_id"] = request.at("id").AsInt();
+        response["total_time"] = route_info->weight;
+        response["items"] = std::move(items);
     } else {
-        response["request_id"s] = request.at("id"s).AsInt();
-        response["error_message"s] = "not found"s;
+        response["request_id"] = request.at("id").AsInt();
+        response["error_message"] = "not found"s;
     }
     return response;
 }
 
 geo::Coordinates JsonReader::ParseCoordinates(const Dict& request) {
-    return { request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble() };
+    return { request.at("latitude").AsDouble(), request.at("longitude").AsDouble() };
 }
 
-std::vector<std::pair<std::string_view, int>> JsonReader::ParseDistances(const Dict& request) {
-    const Dict& data = request.at("road_distances"s).AsMap();
+void JsonReader::AddBaseRequest(const Dict& request, TransportCatalogue::Builder& builder) {
+    std::string_view type = request.at("type").AsString();
     
-    std::vector<std::pair<std::string_view, int>> result;
-    result.reserve(data.size());
-    for (const auto& /* std::string, Node */ [destination, distance] : data) {
-        result.emplace_back(destination, distance.AsInt());
+    if (type == "Stop"sv) {
+        std::string_view name = request.at("name").AsString();
+        builder.AddStop(name, ParseCoordinates(request));
+        for (const auto& /* String, Node */ [destination, distance] : request.at("road_distances").AsMap()) {
+            builder.AddDistance(name, destination, distance.AsInt());
+        }
+    } else if (type == "Bus"sv) {
+        builder.AddBus(request.at("name").AsString(), ParseRoute(request), request.at("is_roundtrip").AsBool());
     }
-    return result;
 }
 
 std::vector<std::string_view> JsonReader::ParseRoute(const Dict& request) {
-    const Array& data = request.at("stops"s).AsArray();
+    const Array& data = request.at("stops").AsArray();
     
     std::vector<std::string_view> result;
     result.reserve(data.size());
@@ -213,7 +455,7 @@ std::vector<std::string_view> JsonReader::ParseRoute(const Dict& request) {
 
 svg::Color JsonReader::ParseColor(const Node& node) {
     if (node.IsString()) {
-        return node.AsString();
+        return std::string(node.AsString());
     }
     
     const Array& color = node.AsArray();
@@ -227,25 +469,25 @@ svg::Color JsonReader::ParseColor(const Node& node) {
 render::RenderSettings JsonReader::ParseRenderSettings(const Dict& settings) {
     render::RenderSettings result;
     
-    result.width = settings.at("width"s).AsDouble();
-    result.height = settings.at("height"s).AsDouble();
-    result.padding = settings.at("padding"s).AsDouble();
+    result.width = settings.at("width").AsDouble();
+    result.height = settings.at("height").AsDouble();
+    result.padding = settings.at("padding").AsDouble();
     
-    result.line_width = settings.at("line_width"s).AsDouble();
-    result.stop_radius = settings.at("stop_radius"s).AsDouble();
+    result.line_width = settings.at("line_width").AsDouble();
+    result.stop_radius = settings.at("stop_radius").AsDouble();
     
-    result.bus_label_font_size = settings.at("bus_label_font_size"s).AsInt();
-    result.bus_label_offset = svg::Point(settings.at("bus_label_offset"s).AsArray()[0].AsDouble(),
-                                          settings.at("bus_label_offset"s).AsArray()[1].AsDouble());
+    result.bus_label_font_size = settings.at("bus_label_font_size").AsInt();
+    result.bus_label_offset = svg::Point(settings.at("bus_label_offset").AsArray()[0].AsDouble(),
+                                          settings.at("bus_label_offset").AsArray()[1].AsDouble());
     
-    result.stop_label_font_size = settings.at("stop_label_font_size"s).AsInt();
-    result.stop_label_offset = svg::Point(settings.at("stop_label_offset"s).AsArray()[0].AsDouble(),
-                                           settings.at("stop_label_offset"s).AsArray()[1].AsDouble());
+    result.stop_label_font_size = settings.at("stop_label_font_size").AsInt();
+    result.stop_label_offset = svg::Point(settings.at("stop_label_offset").AsArray()[0].AsDouble(),
+                                           settings.at("stop_label_offset").AsArray()[1].AsDouble());
     
-    result.underlayer_color = ParseColor(settings.at("underlayer_color"s));
-    result.underlayer_width = settings.at("underlayer_width"s).AsDouble();
+    result.underlayer_color = ParseColor(settings.at("underlayer_color"));
+    result.underlayer_width = settings.at("underlayer_width").AsDouble();
     
-    const Array& palette = settings.at("color_palette"s).AsArray();
+    const Array& palette = settings.at("color_palette").AsArray();
     std::vector<svg::Color> colors;
     colors.reserve(palette.size());
     for (const Node& color : palette) {
@@ -259,7 +501,127 @@ render::RenderSettings JsonReader::ParseRenderSettings(const Dict& settings) {
 router::RoutingSettings JsonReader::ParseRouteSettings(const Dict& settings) {
     const double KMH_TO_MMIN = 1000.0 / 60.0;
     
-    return { settings.at("bus_wait_time"s).AsInt(), settings.at("bus_velocity"s).AsDouble() * KMH_TO_MMIN };
+    router::RoutingSettings result;
+    result.wait_time = settings.at("bus_wait_time").AsInt();
+    result.velocity = settings.at("bus_velocity").AsDouble() * KMH_TO_MMIN;
+    
+    // число потоков предрасчёта задаётся необязательным ключом "threads"
+    if (auto it = settings.find("threads"sv); it != settings.end()) {
+        result.thread_count = ParseThreadCount(it->second);
+    }
+    
+    // алгоритм поиска пути задаётся необязательным ключом "router"
+    if (auto it = settings.find("router"sv); it != settings.end()) {
+        static const std::unordered_map<std::string_view, router::RouterType> types{
+            {"floyd_warshall"sv, router::RouterType::FLOYD_WARSHALL},
+            {"dijkstra"sv, router::RouterType::DIJKSTRA},
+            {"radix_dijkstra"sv, router::RouterType::RADIX_DIJKSTRA},
+            {"a_star"sv, router::RouterType::A_STAR},
+            {"contraction_hierarchy"sv, router::RouterType::CONTRACTION_HIERARCHY},
+        };
+        if (auto type = types.find(it->second.AsString()); type != types.end()) {
+            result.router_type = type->second;
+        } else {
+            throw std::invalid_argument("Unknown router type "s + std::string(it->second.AsString()));
+        }
+    }
+    
+    // представление поездок в графе задаётся необязательным ключом "graph"
+    if (auto it = settings.find("graph"sv); it != settings.end()) {
+        static const std::unordered_map<std::string_view, router::GraphModel> models{
+            {"all_spans"sv, router::GraphModel::ALL_SPANS},
+            {"ride_chains"sv, router::GraphModel::RIDE_CHAINS},
+        };
+        if (auto model = models.find(it->second.AsString()); model != models.end()) {
+            result.graph_model = model->second;
+        } else {
+            throw std::invalid_argument("Unknown graph model "s + std::string(it->second.AsString()));
+        }
+        // на RIDE_CHAINS по умолчанию Дейкстра: Флойду-Уоршеллу там не хватит памяти
+        if (result.graph_model == router::GraphModel::RIDE_CHAINS && settings.find("router"sv) == settings.end()) {
+            result.router_type = router::RouterType::DIJKSTRA;
+        }
+    } else if (result.router_type == router::RouterType::CONTRACTION_HIERARCHY) {
+        result.graph_model = router::GraphModel::RIDE_CHAINS;
+    }
+    // на плотном графе ALL_SPANS предрасчёт иерархии сжатия в десятки раз дольше Флойда-Уоршелла
+    if (result.router_type == router::RouterType::CONTRACTION_HIERARCHY && result.graph_model == router::GraphModel::ALL_SPANS) {
+        throw std::invalid_argument("Router contraction_hierarchy requires graph ride_chains"s);
+    }
+    // в RIDE_CHAINS вершин в десятки раз больше, чем остановок, и таблица V x V Флойда-Уоршелла занимает гигабайты
+    if (result.router_type == router::RouterType::FLOYD_WARSHALL && result.graph_model == router::GraphModel::RIDE_CHAINS) {
+        throw std::invalid_argument("Router floyd_warshall requires graph all_spans"s);
+    }
+    
+    // размер кэша ответов задаётся необязательным ключом "cache_size"; по умолчанию кэша нет
+    if (auto it = settings.find("cache_size"sv); it != settings.end()) {
+        const int cache_size = it->second.AsInt();
+        if (cache_size < 0) {
+            throw std::invalid_argument("Negative route cache size"s);
+        }
+        result.cache_capacity = static_cast<size_t>(cache_size);
+    }
+    
+    return result;
+}
+
+size_t JsonReader::ParseThreadCount(const Node& node) {
+    // 0 -- по числу ядер
+    const int threads = node.AsInt();
+    return threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+const render::RenderSettings& JsonReader::GetRenderSettings() {
+    if (!render_settings_) {
+        render_settings_ = ParseRenderSettings(input_.GetRoot().AsMap().at("render_settings").AsMap());
+    }
+    return *render_settings_;
+}
+
+std::string_view JsonReader::GetSnapshotPath() const {
+    return input_.GetRoot().AsMap().at("serialization_settings").AsMap().at("file").AsString();
+}
+
+size_t JsonReader::GetStatThreadCount() const {
+    // число потоков для ответов на запросы задаётся необязательным разделом "stat_settings"
+    const Dict& root = input_.GetRoot().AsMap();
+    if (auto settings = root.find("stat_settings"sv); settings != root.end()) {
+        if (auto it = settings->second.AsMap().find("threads"sv); it != settings->second.AsMap().end()) {
+            return ParseThreadCount(it->second);
+        }
+    }
+    return 1;
+}
+
+TransportCatalogue& JsonReader::GetMutableCatalogue() {
+    if (!mutable_catalogue_) {
+        throw std::logic_error("Catalogue is read-only"s);
+    }
+    return *mutable_catalogue_;
+}
+
+const router::TransportRouter& JsonReader::GetRouter() {
+    if (shared_router_) {
+        return *shared_router_;
+    }
+    std::call_once(router_flag_, [this] {
+        // маршрутизатор мог быть уже построен для снимка или восстановлен из него
+        if (!router_) {
+            const Dict& settings = input_.GetRoot().AsMap().at("routing_settings").AsMap();
+            router_ = std::make_unique<router::TransportRouter>(ParseRouteSettings(settings), catalogue_);
+        }
+    });
+    return *router_;
+}
+
+const std::string& JsonReader::GetMap() {
+    std::call_once(map_flag_, [this] {
+        render::MapRenderer renderer(render::RenderSettings(GetRenderSettings()), catalogue_);
+        std::ostringstream oss;
+        renderer.RenderMap(oss, 0, 4);
+        map_ = std::move(oss).str();
+    });
+    return map_;
 }
 
 } // namespace json
@@ -2,41 +2,88 @@
 
 #include "json.h"
 #include "map_renderer.h"
+#include "serialization.h"
 #include "transport_router.h"
 
+#include <mutex>
+#include <string>
+
 namespace json {
 
 class JsonReader {
 private:
-    using MapRenderer = std::unique_ptr<render::MapRenderer>;
     using TransportRouter = std::unique_ptr<router::TransportRouter>;
     
 public:
     JsonReader(catalogue::TransportCatalogue& catalogue, const Document& input, std::ostream& output)
-        : catalogue_(catalogue), input_(input), output_(output) {}
+        : catalogue_(catalogue), mutable_catalogue_(&catalogue), input_(input), output_(output) {}
+    // только ответы на запросы по готовой версии базы (например, закреплённой в service::TransportService):
+    // справочник не меняется, а маршрутизатор router, если он задан, используется вместо построения нового
+    JsonReader(const catalogue::TransportCatalogue& catalogue, const router::TransportRouter* router,
+               const Document& input, std::ostream& output)
+        : catalogue_(catalogue), input_(input), output_(output), shared_router_(router) {}
     
     void ProcessBaseRequests();
+    // потоковый вариант: base_requests разбираются по мере чтения, остальные разделы возвращаются документом
+    static Document ProcessBaseRequests(std::istream& input, catalogue::TransportCatalogue& catalogue);
+    static Document ProcessBaseRequests(std::string_view input, catalogue::TransportCatalogue& catalogue);
+    // изменение заполненного справочника запросами в формате base_requests: известные остановки и автобусы
+    // заменяются, новые добавляются, а заданные расстояния заменяют прежние
+    static void ApplyBaseRequests(const Array& requests, catalogue::TransportCatalogue& catalogue);
+    static router::RoutingSettings ParseRouteSettings(const Dict& settings);
+    void SerializeBase();
+    void DeserializeBase();
     void PrintStats(int step = 4, int indent = 0);
+    // ответы без отступов и переводов строк: так вывод заметно короче
+    void PrintCompactStats();
     void RenderMap(int step = 0, int indent = 4);
     
 private:
-    const Document ProcessStatRequests();
+    class BaseRequestsHandler;
     
+    // каждый ответ передаётся writer сразу, как только он готов
+    void ProcessStatRequests(Writer& writer);
+    // ответы считаются в thread_count потоках, а выводятся в исходном порядке
+    void ProcessStatRequests(const Array& requests, Writer& writer, size_t thread_count);
+    
+    // для запроса неизвестного типа ответа нет: возвращается null
+    Node MakeResponse(const Dict& request);
     Dict MakeBusResponse(const Dict& request);
     Dict MakeStopResponse(const Dict& request);
-    static Dict MakeMapResponse(const Dict& request, const MapRenderer& renderer);
-    static Dict MakeRouteResponse(const Dict& request, const TransportRouter& router);
+    Dict MakeMapResponse(const Dict& request);
+    Dict MakeRouteResponse(const Dict& request);
     
+    // передаёт запрос из base_requests строителю справочника
+    static void AddBaseRequest(const Dict& request, catalogue::TransportCatalogue::Builder& builder);
     static geo::Coordinates ParseCoordinates(const Dict& request);
-    static std::vector<std::pair<std::string_view, int>> ParseDistances(const Dict& request);
     static std::vector<std::string_view> ParseRoute(const Dict& request);
     static svg::Color ParseColor(const Node& node);
     static render::RenderSettings ParseRenderSettings(const Dict& settings);
-    static router::RoutingSettings ParseRouteSettings(const Dict& settings);
+    static size_t ParseThreadCount(const Node& node);
     
-    catalogue::TransportCatalogue& catalogue_;
+    // std::logic_error, если читатель создан только для ответов на запросы
+    catalogue::TransportCatalogue& GetMutableCatalogue();
+    const render::RenderSettings& GetRenderSettings();
+    std::string_view GetSnapshotPath() const;
+    size_t GetStatThreadCount() const;
+    
+    // маршрутизатор и карта создаются при первом запросе и один раз, даже если запросы обрабатываются в нескольких потоках
+    const router::TransportRouter& GetRouter();
+    const std::string& GetMap();
+    
+    const catalogue::TransportCatalogue& catalogue_;
+    catalogue::TransportCatalogue* mutable_catalogue_ = nullptr;
     const Document& input_;
     std::ostream& output_;
+    
+    // маршрутизатор из снимка ссылается на его память, поэтому снимок объявлен раньше
+    std::unique_ptr<io::MappedFile> snapshot_;
+    std::optional<render::RenderSettings> render_settings_;
+    TransportRouter router_;
+    const router::TransportRouter* shared_router_ = nullptr;
+    std::once_flag router_flag_;
+    std::string map_;
+    std::once_flag map_flag_;
 };
 
 } // namespace json
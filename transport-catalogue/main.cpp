@@ -1,11 +1,52 @@
 #include "json_reader.h"
+#include "mapped_file.h"
+#include "transport_service.h"
 
+#include <condition_variable>
+#include <stop_token>
+#include <deque>
 #include <iostream>
+#include <mutex>
+#include <optional>
 #include <sstream>
+#include <string_view>
+#include <thread>
+
+#include <unistd.h>
 
 using namespace std::literals;
 
-int main() {
+namespace {
+
+void PrintUsage(std::ostream& stream = std::cerr) {
+    stream << "Usage: transport_catalogue [make_base|process_requests [--compact]|serve]\n"sv;
+}
+
+/*
+ * Входные данные целиком: stdin, перенаправленный из файла, отображается в память,
+ * а из канала данные читаются в буфер.
+ */
+class Input {
+public:
+    Input() {
+        if (io::MappedFile::CanMap(STDIN_FILENO)) {
+            file_.emplace(STDIN_FILENO);
+        } else {
+            std::ostringstream oss;
+            oss << std::cin.rdbuf();
+            buffer_ = std::move(oss).str();
+        }
+    }
+    
+    inline std::string_view GetText() const { return file_ ? file_->GetText() : std::string_view(buffer_); }
+    
+private:
+    std::optional<io::MappedFile> file_;
+    std::string buffer_;
+};
+
+// без аргументов разбираем встроенный пример целиком: и базу, и запросы к ней
+void RunDemo() {
     std::istringstream iss(R"({
       "base_requests": [
           {
@@ -126,10 +167,122 @@ int main() {
     })"s);
     
     catalogue::TransportCatalogue catalogue;
-    const json::Document& input = json::Load(iss);
+    const json::Document input = json::JsonReader::ProcessBaseRequests(iss, catalogue);
     
     json::JsonReader reader(catalogue, input, std::cout);
-    reader.ProcessBaseRequests();
     reader.PrintStats();
     //reader.RenderMap();
 }
+
+/*
+ * Справочник под нагрузкой: из stdin читаются JSON-документы один за другим. Первый документ задаёт базу
+ * (base_requests и необязательные routing_settings). В каждом следующем base_requests -- изменения базы,
+ * которые применяет отдельный поток-писатель (ApplyBaseRequests), а на stat_requests любого документа сразу
+ * отвечает основной поток по последней опубликованной версии базы, не дожидаясь писателя: ответ может ещё
+ * не учитывать изменения из предыдущих документов. Ответы на каждый документ выводятся одной строкой.
+ * Запросам Map нужны render_settings в том же документе.
+ */
+void RunService() {
+    auto initial = std::make_unique<service::Base>();
+    json::Document first = json::JsonReader::ProcessBaseRequests(std::cin, initial->catalogue);
+    if (auto it = first.GetRoot().AsMap().find("routing_settings"sv); it != first.GetRoot().AsMap().end()) {
+        initial->router = std::make_unique<router::TransportRouter>(
+            json::JsonReader::ParseRouteSettings(it->second.AsMap()), initial->catalogue);
+    }
+    service::TransportService transport_service(std::move(initial));
+    
+    std::mutex mutex;
+    std::condition_variable_any has_updates;
+    std::deque<json::Document> updates;
+    
+    // при выходе из функции писатель применит оставшиеся изменения и завершится
+    std::jthread writer([&](std::stop_token stop_token) {
+        for (;;) {
+            std::unique_lock lock(mutex);
+            has_updates.wait(lock, stop_token, [&updates] { return !updates.empty(); });
+            if (updates.empty()) {
+                return;
+            }
+            const json::Document update = std::move(updates.front());
+            updates.pop_front();
+            lock.unlock();
+            
+            // ошибочное изменение не публикуется целиком, база остаётся прежней
+            try {
+                transport_service.Update([&update](catalogue::TransportCatalogue& catalogue) {
+                    json::JsonReader::ApplyBaseRequests(update.GetRoot().AsMap().at("base_requests").AsArray(), catalogue);
+                });
+            } catch (const std::exception& e) {
+                std::cerr << "Update is rejected: "sv << e.what() << '\n';
+            }
+        }
+    });
+    
+    service::TransportService::Reader reader(transport_service.GetVersions());
+    auto answer = [&reader](const json::Document& input) {
+        if (!input.GetRoot().AsMap().count("stat_requests"sv)) {
+            return;
+        }
+        // ошибка в одном документе не останавливает сервис
+        try {
+            const auto base = reader.Pin();
+            json::JsonReader(base->catalogue, base->router.get(), input, std::cout).PrintCompactStats();
+        } catch (const std::exception& e) {
+            std::cout << std::endl;
+            std::cerr << "Requests are rejected: "sv << e.what() << '\n';
+        }
+    };
+    
+    answer(first);
+    while (std::cin >> std::ws && std::cin.peek() != std::istream::traits_type::eof()) {
+        json::Document input = json::Load(std::cin);
+        answer(input);
+        if (input.GetRoot().AsMap().count("base_requests"sv)) {
+            std::lock_guard guard(mutex);
+            updates.push_back(std::move(input));
+            has_updates.notify_one();
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc == 1) {
+        RunDemo();
+        return 0;
+    }
+    const std::string_view mode(argv[1]);
+    if (argc == 2 && mode == "serve"sv) {
+        RunService();
+        return 0;
+    }
+    // компактный вывод ответов без отступов годится только для process_requests
+    const bool is_compact = argc == 3 && argv[2] == "--compact"sv;
+    if (argc > 3 || (argc == 3 && !(is_compact && mode == "process_requests"sv))) {
+        PrintUsage();
+        return 1;
+    }
+    
+    catalogue::TransportCatalogue catalogue;
+    
+    if (mode == "make_base"sv) {
+        // заполняем справочник и сохраняем его вместе с готовым маршрутизатором в файл снимка
+        const json::Document input = json::JsonReader::ProcessBaseRequests(Input().GetText(), catalogue);
+        json::JsonReader reader(catalogue, input, std::cout);
+        reader.SerializeBase();
+    } else if (mode == "process_requests"sv) {
+        // справочник и маршрутизатор берём из снимка, из входных данных читаем только запросы
+        const json::Document input = json::Load(Input().GetText());
+        json::JsonReader reader(catalogue, input, std::cout);
+        reader.DeserializeBase();
+        if (is_compact) {
+            reader.PrintCompactStats();
+        } else {
+            reader.PrintStats();
+        }
+    } else {
+        PrintUsage();
+        return 1;
+    }
+}
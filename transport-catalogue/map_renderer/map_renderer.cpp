@@ -119,7 +119,7 @@ void MapRenderer::DrawBusNames() {
                                      .SetFontSize(settings_.bus_label_font_size)
                                      .SetFontFamily("Verdana")
                                      .SetFontWeight("bold")
-                                     .SetData(bus->name));
+                                     .SetData(std::string(bus->name)));
             
             // foreground
             document_.Add(svg::Text().SetFillColor(settings_.colors[color_id])
@@ -128,7 +128,7 @@ void MapRenderer::DrawBusNames() {
                                      .SetFontSize(settings_.bus_label_font_size)
                                      .SetFontFamily("Verdana")
                                      .SetFontWeight("bold")
-                                     .SetData(bus->name));
+                                     .SetData(std::string(bus->name)));
         }
         ++color_id %= settings_.colors.size();
     }
@@ -162,7 +162,7 @@ void MapRenderer::DrawStopNames() {
                                  .SetOffset(settings_.stop_label_offset)
                                  .SetFontSize(settings_.stop_label_font_size)
                                  .SetFontFamily("Verdana")
-                                 .SetData(stop->name));
+                                 .SetData(std::string(stop->name)));
         
         // foreground
         document_.Add(svg::Text().SetFillColor("black")
@@ -170,7 +170,7 @@ void MapRenderer::DrawStopNames() {
                                  .SetOffset(settings_.stop_label_offset)
                                  .SetFontSize(settings_.stop_label_font_size)
                                  .SetFontFamily("Verdana")
-                                 .SetData(stop->name));
+                                 .SetData(std::string(stop->name)));
     }
 }
 
@@ -0,0 +1,61 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std::literals;
+
+namespace io {
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open "s + path.string());
+    }
+    
+    try {
+        Map(fd, path.native());
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    // отображение остаётся действительным и после закрытия дескриптора
+    close(fd);
+}
+
+MappedFile::MappedFile(int fd) {
+    Map(fd, "file descriptor "s + std::to_string(fd));
+}
+
+MappedFile::~MappedFile() {
+    if (!data_.empty()) {
+        munmap(const_cast<char*>(data_.data()), data_.size());
+    }
+}
+
+bool MappedFile::CanMap(int fd) {
+    struct stat info;
+    return fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+}
+
+void MappedFile::Map(int fd, std::string_view name) {
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        throw std::runtime_error("Failed to stat "s + std::string(name));
+    }
+    
+    if (const size_t size = static_cast<size_t>(info.st_size); size > 0) {
+        void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Failed to map "s + std::string(name));
+        }
+        data_ = std::span<const char>(static_cast<const char*>(data), size);
+    }
+}
+
+} // namespace io
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+namespace io {
+
+// файл, отображённый в память только для чтения
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path& path);
+    // дескриптор не закрывается; отображать можно только обычные файлы, см. CanMap
+    explicit MappedFile(int fd);
+    ~MappedFile();
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+    
+    // из каналов и терминалов данные можно только читать
+    static bool CanMap(int fd);
+    
+    inline std::span<const char> GetData() const { return data_; }
+    inline std::string_view GetText() const { return {data_.data(), data_.size()}; }
+    
+private:
+    void Map(int fd, std::string_view name);
+    
+    std::span<const char> data_;
+};
+
+} // namespace io
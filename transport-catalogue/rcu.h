@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace rcu {
+
+/*
+ * Версии объекта по схеме read-copy-update с эпохами. Писатель строит новую неизменяемую версию рядом
+ * с текущей и публикует её одной атомарной заменой указателя, а прежняя версия освобождается, когда её
+ * больше не держит ни один читатель. Закрепление версии не берёт блокировок и не ждёт писателя: это запись
+ * эпохи в ячейку читателя и чтение указателя. Каждый поток-читатель заранее заводит себе Reader.
+ *
+ * Так хранятся версии справочника вместе с маршрутизатором по нему (см. service::TransportService):
+ *     rcu::Versioned<service::Base> base(...);
+ *     rcu::Versioned<service::Base>::Reader reader(base);    // в потоке-читателе
+ *     auto snapshot = reader.Pin();                          // snapshot->catalogue.GetBus(...)
+ */
+template <typename T>
+class Versioned {
+private:
+    static constexpr uint64_t IDLE = std::numeric_limits<uint64_t>::max();
+    
+    // ячейка читателя: эпоха, в которой он закрепил версию, или IDLE; ячейки не удаляются до конца работы
+    struct Slot {
+        std::atomic<uint64_t> epoch{IDLE};
+        std::atomic<bool> is_used{true};
+        Slot* next = nullptr;
+    };
+    
+public:
+    class Reader;
+    
+    // закреплённая версия: пока объект жив, версия не будет освобождена
+    class Snapshot {
+    public:
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        ~Snapshot() { reader_.Unpin(); }
+        
+        inline const T& operator*() const { return *value_; }
+        inline const T* operator->() const { return value_; }
+        inline const T* Get() const { return value_; }
+    
+    private:
+        friend class Reader;
+        
+        Snapshot(Reader& reader, const T* value) : reader_(reader), value_(value) {}
+        
+        Reader& reader_;
+        const T* value_;
+    };
+    
+    // читатель принадлежит одному потоку; закрепления в нём могут быть вложенными
+    class Reader {
+    public:
+        explicit Reader(const Versioned& versioned) : versioned_(versioned), slot_(versioned.AcquireSlot()) {}
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+        ~Reader() { slot_->is_used.store(false, std::memory_order_release); }
+        
+        Snapshot Pin() {
+            // писатель освобождает версию только после того, как все закреплённые эпохи стали новее её замены
+            if (depth_++ == 0) {
+                slot_->epoch.store(versioned_.epoch_.load());
+            }
+            return Snapshot(*this, versioned_.current_.load());
+        }
+    
+    private:
+        friend class Snapshot;
+        
+        void Unpin() {
+            if (--depth_ == 0) {
+                slot_->epoch.store(IDLE, std::memory_order_release);
+            }
+        }
+        
+        const Versioned& versioned_;
+        Slot* slot_;
+        size_t depth_ = 0;
+    };
+    
+    explicit Versioned(std::unique_ptr<T> initial) : current_(initial.release()) {}
+    Versioned(const Versioned&) = delete;
+    Versioned& operator=(const Versioned&) = delete;
+    // к моменту разрушения читателей уже не должно быть
+    ~Versioned();
+    
+    // build получает текущую версию и возвращает следующую (std::unique_ptr<T>); писатели выполняются по очереди
+    template <typename Builder>
+    void Update(Builder&& build);
+    void Publish(std::unique_ptr<T> next);
+    // освобождает версии, которые больше никто не держит; Update и Publish вызывают его сами
+    void Reclaim();
+    
+private:
+    // заменённая версия и эпоха, начавшаяся сразу после замены
+    struct Retired {
+        std::unique_ptr<const T> value;
+        uint64_t epoch;
+    };
+    
+    Slot* AcquireSlot() const;
+    void PublishLocked(std::unique_ptr<T> next);
+    void ReclaimLocked();
+    
+    std::atomic<const T*> current_;
+    std::atomic<uint64_t> epoch_{0};
+    mutable std::atomic<Slot*> slots_{nullptr};
+    
+    std::mutex writer_mutex_;
+    std::vector<Retired> retired_;
+};
+
+template <typename T>
+Versioned<T>::~Versioned() {
+    delete current_.load();
+    for (Slot* slot = slots_.load(); slot;) {
+        delete std::exchange(slot, slot->next);
+    }
+}
+
+template <typename T>
+template <typename Builder>
+void Versioned<T>::Update(Builder&& build) {
+    std::lock_guard guard(writer_mutex_);
+    // текущую версию освобождает только писатель, поэтому под мьютексом её можно читать без закрепления
+    PublishLocked(build(*current_.load()));
+}
+
+template <typename T>
+void Versioned<T>::Publish(std::unique_ptr<T> next) {
+    std::lock_guard guard(writer_mutex_);
+    PublishLocked(std::move(next));
+}
+
+template <typename T>
+void Versioned<T>::Reclaim() {
+    std::lock_guard guard(writer_mutex_);
+    ReclaimLocked();
+}
+
+template <typename T>
+typename Versioned<T>::Slot* Versioned<T>::AcquireSlot() const {
+    // сначала пробуем занять ячейку ушедшего читателя, а если свободных нет -- добавляем новую в начало списка
+    for (Slot* slot = slots_.load(); slot; slot = slot->next) {
+        bool expected = false;
+        if (slot->is_used.compare_exchange_strong(expected, true)) {
+            return slot;
+        }
+    }
+    
+    Slot* slot = new Slot();
+    slot->next = slots_.load();
+    while (!slots_.compare_exchange_weak(slot->next, slot)) {
+    }
+    return slot;
+}
+
+template <typename T>
+void Versioned<T>::PublishLocked(std::unique_ptr<T> next) {
+    const T* previous = current_.exchange(next.release());
+    // читатель, закрепивший эпоху не раньше новой, прочтёт уже новый указатель
+    retired_.push_back({std::unique_ptr<const T>(previous), epoch_.fetch_add(1) + 1});
+    ReclaimLocked();
+}
+
+template <typename T>
+void Versioned<T>::ReclaimLocked() {
+    uint64_t min_epoch = IDLE;
+    for (Slot* slot = slots_.load(); slot; slot = slot->next) {
+        min_epoch = std::min(min_epoch, slot->epoch.load());
+    }
+    
+    std::erase_if(retired_, [min_epoch](const Retired& retired) {
+        return retired.epoch <= min_epoch;
+    });
+}
+
+} // namespace rcu
@@ -0,0 +1,432 @@
+#include "serialization.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <string_view>
+#include <type_traits>
+
+using namespace std::literals;
+using namespace catalogue;
+
+namespace serialization {
+
+namespace {
+
+using Weight = router::TransportRouter::Weight;
+using PrevEdge = graph::Router<Weight>::PrevEdge;
+
+/*
+ * Формат снимка: заголовок, затем последовательно справочник, настройки отрисовки и маршрутизатор.
+ * Числа пишутся в порядке байтов машины, поэтому в заголовке есть метка порядка байтов и размер size_t.
+ * Большие массивы (граф и таблица маршрутизатора) выровнены относительно начала файла, чтобы при
+ * загрузке на них можно было сослаться прямо в отображённой памяти.
+ */
+constexpr std::array<char, 8> MAGIC{'T', 'C', 'S', 'N', 'A', 'P', '\0', '\0'};
+constexpr uint32_t VERSION = 4;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+class Writer {
+public:
+    explicit Writer(std::ostream& output) : output_(output) {}
+    
+    template <typename T>
+    void Write(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        WriteBytes(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    
+    void WriteString(std::string_view value) {
+        Write(static_cast<uint32_t>(value.size()));
+        WriteBytes(value.data(), value.size());
+    }
+    
+    template <typename T>
+    void WriteArray(std::span<const T> values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        Write(static_cast<uint64_t>(values.size()));
+        Align(alignof(T));
+        WriteBytes(reinterpret_cast<const char*>(values.data()), values.size_bytes());
+    }
+    
+private:
+    void WriteBytes(const char* data, size_t size) {
+        output_.write(data, static_cast<std::streamsize>(size));
+        position_ += size;
+    }
+    
+    void Align(size_t alignment) {
+        static constexpr char ZEROES[alignof(std::max_align_t)] = {};
+        WriteBytes(ZEROES, (alignment - position_ % alignment) % alignment);
+    }
+    
+    std::ostream& output_;
+    size_t position_ = 0;
+};
+
+class Reader {
+public:
+    explicit Reader(std::span<const char> data) : data_(data) {}
+    
+    template <typename T>
+    T Read() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        Require(sizeof(T));
+        T value;
+        std::memcpy(&value, data_.data() + position_, sizeof(T));
+        position_ += sizeof(T);
+        return value;
+    }
+    
+    std::string_view ReadString() {
+        const uint32_t size = Read<uint32_t>();
+        Require(size);
+        std::string_view result(data_.data() + position_, size);
+        position_ += size;
+        return result;
+    }
+    
+    // массив не копируется: возвращается представление прямо в памяти снимка
+    template <typename T>
+    std::span<const T> ReadArray() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const uint64_t size = Read<uint64_t>();
+        Require((alignof(T) - position_ % alignof(T)) % alignof(T));
+        position_ += (alignof(T) - position_ % alignof(T)) % alignof(T);
+        if (size > (data_.size() - position_) / sizeof(T)) {
+            throw SnapshotError("Snapshot is truncated"s);
+        }
+        const T* begin = std::launder(reinterpret_cast<const T*>(data_.data() + position_));
+        position_ += size * sizeof(T);
+        return {begin, static_cast<size_t>(size)};
+    }
+    
+private:
+    void Require(size_t size) const {
+        if (size > data_.size() - position_) {
+            throw SnapshotError("Snapshot is truncated"s);
+        }
+    }
+    
+    std::span<const char> data_;
+    size_t position_ = 0;
+};
+
+// ---------- Справочник ------------------
+
+void SaveCatalogue(Writer& writer, const TransportCatalogue& catalogue) {
+    writer.Write(static_cast<uint32_t>(catalogue.GetStopsData().size()));
+    for (const Stop& stop : catalogue.GetStopsData()) {
+        writer.WriteString(stop.name);
+        writer.Write(stop.coords.lat);
+        writer.Write(stop.coords.lng);
+        writer.Write(static_cast<uint8_t>(catalogue.IsRemoved(&stop)));
+    }
+    
+    // расстояния по обратному направлению восстановятся при загрузке сами
+    uint32_t distance_count = 0;
+    for (const Stop& stop : catalogue.GetStopsData()) {
+        for (const TransportCatalogue::RoadDistance& road : catalogue.GetRoadDistances(stop.id)) {
+            distance_count += road.is_explicit;
+        }
+    }
+    writer.Write(distance_count);
+    for (const Stop& stop : catalogue.GetStopsData()) {
+        for (const TransportCatalogue::RoadDistance& road : catalogue.GetRoadDistances(stop.id)) {
+            if (road.is_explicit) {
+                writer.Write(static_cast<uint32_t>(stop.id));
+                writer.Write(static_cast<uint32_t>(road.to));
+                writer.Write(static_cast<int32_t>(road.distance));
+            }
+        }
+    }
+    
+    writer.Write(static_cast<uint32_t>(catalogue.GetBusesData().size()));
+    for (const Bus& bus : catalogue.GetBusesData()) {
+        // некольцевой маршрут хранится отзеркаленным, а записываем его в исходном виде
+        const size_t stop_count = bus.type == RouteType::RING ? bus.route.size() : (bus.route.size() + 1) / 2;
+        writer.WriteString(bus.name);
+        writer.Write(static_cast<uint8_t>(bus.type == RouteType::RING));
+        writer.Write(static_cast<uint8_t>(catalogue.IsRemoved(&bus)));
+        writer.Write(static_cast<uint32_t>(stop_count));
+        for (size_t i = 0; i < stop_count; ++i) {
+            writer.Write(static_cast<uint32_t>(bus.route[i]->id));
+        }
+    }
+}
+
+void LoadCatalogue(Reader& reader, TransportCatalogue& catalogue) {
+    /*
+     * Отметка «не находится по названию» ставится и удалённому объекту, и повтору уже занятого названия.
+     * Объекты восстанавливаются на своих местах, чтобы номера совпали с записанными, а отмеченные скрываются
+     * по номеру: удаление по названию задело бы первый объект с этим названием, а у повтора стёрло бы маршрут.
+     */
+    const uint32_t stop_count = reader.Read<uint32_t>();
+    std::vector<std::string_view> stop_names;
+    stop_names.reserve(stop_count);
+    for (uint32_t i = 0; i < stop_count; ++i) {
+        std::string_view name = reader.ReadString();
+        geo::Coordinates coords;
+        coords.lat = reader.Read<double>();
+        coords.lng = reader.Read<double>();
+        catalogue.AddStop(name, std::move(coords));
+        if (reader.Read<uint8_t>() != 0) {
+            catalogue.HideStop(i);
+        }
+        stop_names.push_back(name);
+    }
+    
+    // расстояния и маршруты записаны по номерам, а восстанавливаются по названиям: название должно вести
+    // к той же остановке, иначе снимок противоречит сам себе
+    auto stop_name = [&stop_names, &catalogue](uint32_t id) {
+        if (id >= stop_names.size()) {
+            throw SnapshotError("Snapshot refers to unknown stop"s);
+        }
+        const Stop* stop = catalogue.GetStop(stop_names[id]);
+        if (!stop || stop->id != id) {
+            throw SnapshotError("Snapshot refers to removed stop"s);
+        }
+        return stop_names[id];
+    };
+    
+    const uint32_t distance_count = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < distance_count; ++i) {
+        const uint32_t from = reader.Read<uint32_t>();
+        const uint32_t to = reader.Read<uint32_t>();
+        catalogue.AddDistance(stop_name(from), stop_name(to), reader.Read<int32_t>());
+    }
+    
+    const uint32_t bus_count = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < bus_count; ++i) {
+        std::string_view name = reader.ReadString();
+        const bool is_ring = reader.Read<uint8_t>() != 0;
+        const bool is_removed = reader.Read<uint8_t>() != 0;
+        std::vector<std::string_view> route(reader.Read<uint32_t>());
+        for (std::string_view& stop : route) {
+            stop = stop_name(reader.Read<uint32_t>());
+        }
+        catalogue.AddBus(name, std::move(route), is_ring);
+        if (is_removed) {
+            catalogue.HideBus(i);
+        }
+    }
+}
+
+// ---------- Настройки отрисовки ------------------
+
+void SaveColor(Writer& writer, const svg::Color& color) {
+    writer.Write(static_cast<uint8_t>(color.index()));
+    if (const auto* name = std::get_if<std::string>(&color)) {
+        writer.WriteString(*name);
+    } else if (const auto* rgba = std::get_if<svg::Rgba>(&color)) {
+        writer.Write(rgba->red);
+        writer.Write(rgba->green);
+        writer.Write(rgba->blue);
+        writer.Write(rgba->opacity);
+    } else if (const auto* rgb = std::get_if<svg::Rgb>(&color)) {
+        writer.Write(rgb->red);
+        writer.Write(rgb->green);
+        writer.Write(rgb->blue);
+    }
+}
+
+svg::Color LoadColor(Reader& reader) {
+    switch (reader.Read<uint8_t>()) {
+        case 0:
+            return std::monostate();
+        case 1:
+            return std::string(reader.ReadString());
+        case 2: {
+            const uint8_t red = reader.Read<uint8_t>(), green = reader.Read<uint8_t>(), blue = reader.Read<uint8_t>();
+            return svg::Rgb(red, green, blue);
+        }
+        case 3: {
+            const uint8_t red = reader.Read<uint8_t>(), green = reader.Read<uint8_t>(), blue = reader.Read<uint8_t>();
+            return svg::Rgba(red, green, blue, reader.Read<double>());
+        }
+        default:
+            throw SnapshotError("Snapshot contains unknown color type"s);
+    }
+}
+
+void SavePoint(Writer& writer, const svg::Point& point) {
+    writer.Write(point.x);
+    writer.Write(point.y);
+}
+
+svg::Point LoadPoint(Reader& reader) {
+    const double x = reader.Read<double>();
+    return svg::Point(x, reader.Read<double>());
+}
+
+void SaveRenderSettings(Writer& writer, const render::RenderSettings& settings) {
+    writer.Write(settings.width);
+    writer.Write(settings.height);
+    writer.Write(settings.padding);
+    writer.Write(settings.line_width);
+    writer.Write(settings.stop_radius);
+    writer.Write(static_cast<int32_t>(settings.bus_label_font_size));
+    SavePoint(writer, settings.bus_label_offset);
+    writer.Write(static_cast<int32_t>(settings.stop_label_font_size));
+    SavePoint(writer, settings.stop_label_offset);
+    SaveColor(writer, settings.underlayer_color);
+    writer.Write(settings.underlayer_width);
+    
+    writer.Write(static_cast<uint32_t>(settings.colors.size()));
+    for (const svg::Color& color : settings.colors) {
+        SaveColor(writer, color);
+    }
+}
+
+render::RenderSettings LoadRenderSettings(Reader& reader) {
+    render::RenderSettings settings;
+    settings.width = reader.Read<double>();
+    settings.height = reader.Read<double>();
+    settings.padding = reader.Read<double>();
+    settings.line_width = reader.Read<double>();
+    settings.stop_radius = reader.Read<double>();
+    settings.bus_label_font_size = reader.Read<int32_t>();
+    settings.bus_label_offset = LoadPoint(reader);
+    settings.stop_label_font_size = reader.Read<int32_t>();
+    settings.stop_label_offset = LoadPoint(reader);
+    settings.underlayer_color = LoadColor(reader);
+    settings.underlayer_width = reader.Read<double>();
+    
+    settings.colors.resize(reader.Read<uint32_t>());
+    for (svg::Color& color : settings.colors) {
+        color = LoadColor(reader);
+    }
+    return settings;
+}
+
+// ---------- Маршрутизатор ------------------
+
+void SaveRouter(Writer& writer, const router::TransportRouter& router) {
+    const router::RoutingSettings& settings = router.GetSettings();
+    writer.Write(static_cast<int32_t>(settings.wait_time));
+    writer.Write(settings.velocity);
+    writer.Write(static_cast<uint8_t>(settings.router_type));
+    writer.Write(static_cast<uint8_t>(settings.graph_model));
+    writer.Write(static_cast<uint64_t>(settings.thread_count));
+    writer.Write(static_cast<uint64_t>(settings.cache_capacity));
+    
+    const graph::CsrGraph<Weight>& graph = router.GetGraph();
+    writer.WriteArray(graph.GetOffsets());
+    writer.WriteArray(graph.GetEdges());
+    
+    // рёбра описаны номерами остановок и автобусов, поэтому пишутся как есть
+    writer.WriteArray(std::span<const router::EdgeInfo>(router.GetEdgeInfos()));
+    
+    if (auto table = router.GetRoutesTable()) {
+        writer.Write(uint8_t{1});
+        writer.WriteArray(table->weights);
+        writer.WriteArray(table->prev_edges);
+    } else {
+        writer.Write(uint8_t{0});
+    }
+}
+
+std::unique_ptr<router::TransportRouter> LoadRouter(Reader& reader, const TransportCatalogue& catalogue) {
+    router::RoutingSettings settings;
+    settings.wait_time = reader.Read<int32_t>();
+    settings.velocity = reader.Read<double>();
+    const uint8_t router_type = reader.Read<uint8_t>();
+    if (router_type > static_cast<uint8_t>(router::RouterType::CONTRACTION_HIERARCHY)) {
+        throw SnapshotError("Snapshot contains unknown router type"s);
+    }
+    settings.router_type = static_cast<router::RouterType>(router_type);
+    const uint8_t graph_model = reader.Read<uint8_t>();
+    if (graph_model > static_cast<uint8_t>(router::GraphModel::RIDE_CHAINS)) {
+        throw SnapshotError("Snapshot contains unknown graph model"s);
+    }
+    settings.graph_model = static_cast<router::GraphModel>(graph_model);
+    settings.thread_count = reader.Read<uint64_t>();
+    settings.cache_capacity = reader.Read<uint64_t>();
+    
+    const auto offsets = reader.ReadArray<size_t>();
+    const auto edges = reader.ReadArray<graph::Edge<Weight>>();
+    graph::CsrGraph<Weight> graph(offsets, edges);
+    
+    // номера остановок и автобусов проверяет маршрутизатор
+    const auto infos = reader.ReadArray<router::EdgeInfo>();
+    std::vector<router::EdgeInfo> edge_infos(infos.begin(), infos.end());
+    
+    std::optional<graph::Router<Weight>::RoutesTable> table;
+    if (reader.Read<uint8_t>() != 0) {
+        const auto weights = reader.ReadArray<Weight>();
+        table = graph::Router<Weight>::RoutesTable{weights, reader.ReadArray<PrevEdge>()};
+    }
+    
+    try {
+        return std::make_unique<router::TransportRouter>(std::move(settings), catalogue, std::move(graph),
+                                                         std::move(edge_infos), table);
+    } catch (const std::invalid_argument& error) {
+        throw SnapshotError("Snapshot routing data is inconsistent: "s + error.what());
+    }
+}
+
+} // namespace
+
+void Save(const std::filesystem::path& path, const TransportCatalogue& catalogue,
+          const render::RenderSettings* render_settings, const router::TransportRouter* router) {
+    // граф маршрутизатора, отстающего от справочника, при загрузке с ним не совпадёт
+    if (router && router->GetVersion() != catalogue.GetVersion()) {
+        throw std::logic_error("Router doesn't reflect the latest catalogue changes"s);
+    }
+    
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    if (!output) {
+        throw std::runtime_error("Failed to create snapshot "s + path.string());
+    }
+    
+    Writer writer(output);
+    writer.Write(MAGIC);
+    writer.Write(VERSION);
+    writer.Write(BYTE_ORDER_MARK);
+    writer.Write(static_cast<uint32_t>(sizeof(size_t)));
+    
+    SaveCatalogue(writer, catalogue);
+    
+    writer.Write(static_cast<uint8_t>(render_settings != nullptr));
+    if (render_settings) {
+        SaveRenderSettings(writer, *render_settings);
+    }
+    
+    writer.Write(static_cast<uint8_t>(router != nullptr));
+    if (router) {
+        SaveRouter(writer, *router);
+    }
+    
+    if (!output.flush()) {
+        throw std::runtime_error("Failed to write snapshot "s + path.string());
+    }
+}
+
+Base Load(const io::MappedFile& file, TransportCatalogue& catalogue) {
+    Reader reader(file.GetData());
+    
+    if (reader.Read<std::array<char, 8>>() != MAGIC) {
+        throw SnapshotError("File is not a transport catalogue snapshot"s);
+    }
+    if (reader.Read<uint32_t>() != VERSION) {
+        throw SnapshotError("Unsupported snapshot version"s);
+    }
+    if (reader.Read<uint32_t>() != BYTE_ORDER_MARK || reader.Read<uint32_t>() != sizeof(size_t)) {
+        throw SnapshotError("Snapshot was written on incompatible platform"s);
+    }
+    
+    LoadCatalogue(reader, catalogue);
+    
+    Base base;
+    if (reader.Read<uint8_t>() != 0) {
+        base.render_settings = LoadRenderSettings(reader);
+    }
+    if (reader.Read<uint8_t>() != 0) {
+        base.router = LoadRouter(reader, catalogue);
+    }
+    return base;
+}
+
+} // namespace serialization
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "map_renderer.h"
+#include "mapped_file.h"
+#include "transport_router.h"
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+namespace serialization {
+
+// Эта ошибка выбрасывается, если файл снимка повреждён или записан несовместимой версией
+class SnapshotError : public std::runtime_error {
+public:
+    using runtime_error::runtime_error;
+};
+
+// всё, что восстанавливается из снимка помимо самого справочника
+struct Base {
+    std::optional<render::RenderSettings> render_settings;
+    std::unique_ptr<router::TransportRouter> router;
+};
+
+// make_base: записывает справочник, настройки отрисовки и готовый маршрутизатор (если они есть) в файл
+void Save(const std::filesystem::path& path, const catalogue::TransportCatalogue& catalogue,
+          const render::RenderSettings* render_settings, const router::TransportRouter* router);
+
+/*
+ * process_requests: заполняет пустой справочник данными снимка. Граф и таблица маршрутизатора
+ * не копируются, а используются прямо из отображённой памяти, поэтому file должен жить дольше
+ * возвращённого маршрутизатора.
+ */
+Base Load(const io::MappedFile& file, catalogue::TransportCatalogue& catalogue);
+
+} // namespace serialization
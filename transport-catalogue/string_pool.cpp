@@ -0,0 +1,110 @@
+#include "string_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace intern {
+
+StringPool::StringPool(const StringPool& other)
+    : hashes_(other.hashes_), table_(other.table_) {
+    
+    strings_.reserve(other.strings_.size());
+    for (std::string_view str : other.strings_) {
+        strings_.push_back(Store(str));
+    }
+}
+
+StringPool::StringPool(StringPool&& other) noexcept {
+    *this = std::move(other);
+}
+
+StringPool& StringPool::operator=(StringPool&& other) noexcept {
+    if (this != &other) {
+        // исходный пул остаётся пустым: его свободное место теперь принадлежит чужому блоку
+        blocks_ = std::exchange(other.blocks_, {});
+        block_free_ = std::exchange(other.block_free_, nullptr);
+        block_free_size_ = std::exchange(other.block_free_size_, 0);
+        strings_ = std::exchange(other.strings_, {});
+        hashes_ = std::exchange(other.hashes_, {});
+        table_ = std::exchange(other.table_, {});
+    }
+    return *this;
+}
+
+Symbol StringPool::Intern(std::string_view str) {
+    const size_t hash = Hash(str);
+    if (const Symbol symbol = Find(str, hash); symbol != NO_SYMBOL) {
+        return symbol;
+    }
+    if (strings_.size() >= NO_SYMBOL) {
+        throw std::length_error("Too many strings in pool");
+    }
+    
+    // таблица заполнена не больше чем наполовину: так цепочки проб остаются короткими
+    if (2 * (strings_.size() + 1) > table_.size()) {
+        Grow();
+    }
+    const Symbol symbol = static_cast<Symbol>(strings_.size());
+    table_[FindSlot(str, hash)] = symbol;
+    strings_.push_back(Store(str));
+    hashes_.push_back(hash);
+    return symbol;
+}
+
+Symbol StringPool::Find(std::string_view str) const {
+    return Find(str, Hash(str));
+}
+
+Symbol StringPool::Find(std::string_view str, size_t hash) const {
+    return table_.empty() ? NO_SYMBOL : table_[FindSlot(str, hash)];
+}
+
+size_t StringPool::FindSlot(std::string_view str, size_t hash) const {
+    const size_t mask = table_.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        const Symbol symbol = table_[slot];
+        if (symbol == NO_SYMBOL || (hashes_[symbol] == hash && strings_[symbol] == str)) {
+            return slot;
+        }
+    }
+}
+
+std::string_view StringPool::Store(std::string_view str) {
+    if (str.empty()) {
+        return {};
+    }
+    // длинная строка получает собственный блок, чтобы не оставлять в текущем пустое место
+    if (str.size() > BLOCK_SIZE / 4) {
+        char* data = blocks_.emplace_back(std::make_unique<char[]>(str.size())).get();
+        std::memcpy(data, str.data(), str.size());
+        return {data, str.size()};
+    }
+    if (str.size() > block_free_size_) {
+        block_free_ = blocks_.emplace_back(std::make_unique<char[]>(BLOCK_SIZE)).get();
+        block_free_size_ = BLOCK_SIZE;
+    }
+    
+    char* data = block_free_;
+    std::memcpy(data, str.data(), str.size());
+    block_free_ += str.size();
+    block_free_size_ -= str.size();
+    return {data, str.size()};
+}
+
+void StringPool::Grow() {
+    // строки не перехешируются: у каждого символа хеш уже сохранён
+    std::vector<Symbol> table(std::max<size_t>(16, 2 * table_.size()), NO_SYMBOL);
+    const size_t mask = table.size() - 1;
+    for (Symbol symbol = 0; symbol < strings_.size(); ++symbol) {
+        size_t slot = hashes_[symbol] & mask;
+        while (table[slot] != NO_SYMBOL) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = symbol;
+    }
+    table_ = std::move(table);
+}
+
+} // namespace intern
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace intern {
+
+// номер строки в пуле, в порядке добавления
+using Symbol = uint32_t;
+inline constexpr Symbol NO_SYMBOL = std::numeric_limits<Symbol>::max();
+
+/*
+ * Пул строк: каждая строка хранится один раз и определяется 32-битным символом. Строки лежат подряд
+ * в крупных блоках, которые не перемещаются, поэтому string_view на них действительны, пока жив пул.
+ * Хеш строки считается один раз при поиске, а хеши добавленных строк хранятся: при росте таблицы строки
+ * не перехешируются, а при поиске байты сравниваются только у строк с совпавшим хешем.
+ */
+class StringPool {
+public:
+    StringPool() = default;
+    // копия с теми же символами, но со своими блоками
+    StringPool(const StringPool& other);
+    StringPool& operator=(const StringPool&) = delete;
+    // блоки переходят целиком, поэтому string_view на строки пула остаются действительными
+    StringPool(StringPool&& other) noexcept;
+    StringPool& operator=(StringPool&& other) noexcept;
+    
+    static inline size_t Hash(std::string_view str) { return std::hash<std::string_view>{}(str); }
+    
+    // добавляет строку, если её ещё нет, и возвращает её символ
+    Symbol Intern(std::string_view str);
+    // NO_SYMBOL, если такой строки нет; hash -- заранее посчитанный Hash(str)
+    Symbol Find(std::string_view str) const;
+    Symbol Find(std::string_view str, size_t hash) const;
+    
+    inline std::string_view Get(Symbol symbol) const { return strings_[symbol]; }
+    inline size_t Size() const { return strings_.size(); }
+    
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+    
+    // ячейка таблицы, где лежит str или где её место, если строки нет
+    size_t FindSlot(std::string_view str, size_t hash) const;
+    std::string_view Store(std::string_view str);
+    void Grow();
+    
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* block_free_ = nullptr;
+    size_t block_free_size_ = 0;
+    
+    std::vector<std::string_view> strings_; // по символам
+    std::vector<size_t> hashes_;            // по символам
+    std::vector<Symbol> table_;             // открытая адресация, размер -- степень двойки
+};
+
+} // namespace intern
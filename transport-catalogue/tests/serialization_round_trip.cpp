@@ -0,0 +1,155 @@
+/*
+ * Проверка снимка справочника: после записи и загрузки поиск по названию должен находить ровно те же объекты,
+ * что и до записи, а расстояния, маршруты и сводки по ним -- совпадать. Отдельно проверяются повторы названий
+ * остановок и автобусов во входных данных, удаление и повторное занятие названия.
+ *
+ * Сборка и запуск из каталога transport-catalogue:
+ *     g++ -std=c++20 -O1 -g -fsanitize=address,undefined -I. -Imap_renderer -Itransport_router \
+ *         $(find . -name '*.cpp' ! -name main.cpp ! -path './bench*' ! -path './tests*') \
+ *         tests/serialization_round_trip.cpp -o serialization_round_trip -lpthread
+ *     ./serialization_round_trip
+ */
+
+#include "json_reader.h"
+#include "serialization.h"
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std::literals;
+using catalogue::TransportCatalogue;
+
+namespace {
+
+// остановка B и автобус 1 заданы дважды; расстояние до B должно остаться у первой остановки B
+constexpr std::string_view DUPLICATED_NAMES = R"({"base_requests": [
+    {"type": "Stop", "name": "A", "latitude": 55.6, "longitude": 37.6, "road_distances": {"B": 1000}},
+    {"type": "Stop", "name": "B", "latitude": 55.61, "longitude": 37.6, "road_distances": {"A": 1200}},
+    {"type": "Stop", "name": "B", "latitude": 55.7, "longitude": 37.7, "road_distances": {}},
+    {"type": "Bus", "name": "1", "stops": ["A", "B"], "is_roundtrip": false},
+    {"type": "Bus", "name": "1", "stops": ["B", "A", "B"], "is_roundtrip": true}
+]})"sv;
+
+void FillDuplicatedNames(TransportCatalogue& catalogue) {
+    json::JsonReader::ProcessBaseRequests(DUPLICATED_NAMES, catalogue);
+}
+
+// названия освобождаются удалением и занимаются заново, в том числе когда под названием был повтор
+void FillRemovedNames(TransportCatalogue& catalogue) {
+    catalogue.AddStop("A"sv, {55.6, 37.6});
+    catalogue.AddStop("B"sv, {55.61, 37.6});
+    catalogue.AddStop("C"sv, {55.62, 37.6});
+    catalogue.AddStop("C"sv, {55.63, 37.6});
+    catalogue.AddDistance("A"sv, "B"sv, 1000);
+    catalogue.AddDistance("B"sv, "C"sv, 700);
+    catalogue.AddBus("1"sv, {"A"sv, "B"sv}, false);
+    catalogue.AddBus("2"sv, {"B"sv, "C"sv}, false);
+    catalogue.AddBus("2"sv, {"A"sv}, false);
+    
+    catalogue.RemoveBus("1"sv);
+    catalogue.RemoveBus("2"sv);
+    catalogue.RemoveStop("C"sv);
+    catalogue.RemoveStop("B"sv);
+    catalogue.AddStop("B"sv, {55.64, 37.6});
+    catalogue.AddDistance("B"sv, "A"sv, 1500);
+    catalogue.AddBus("1"sv, {"B"sv, "A"sv}, false);
+}
+
+// возвращает описание несоответствия или пустую строку
+std::string Compare(const TransportCatalogue& expected, const TransportCatalogue& actual) {
+    const auto& expected_stops = expected.GetStopsData();
+    const auto& actual_stops = actual.GetStopsData();
+    if (expected_stops.size() != actual_stops.size() || expected.GetBusesData().size() != actual.GetBusesData().size()) {
+        return "Object count differs"s;
+    }
+    
+    for (size_t i = 0; i < expected_stops.size(); ++i) {
+        const std::string name = std::string(expected_stops[i].name) + " #"s + std::to_string(i);
+        if (expected.IsRemoved(&expected_stops[i]) != actual.IsRemoved(&actual_stops[i])) {
+            return "Stop "s + name + " is indexed differently"s;
+        }
+        if (expected_stops[i].passing_buses != actual_stops[i].passing_buses) {
+            return "Stop "s + name + " buses differ"s;
+        }
+        const auto& expected_roads = expected.GetRoadDistances(expected_stops[i].id);
+        const auto& actual_roads = actual.GetRoadDistances(actual_stops[i].id);
+        if (expected_roads.size() != actual_roads.size()) {
+            return "Stop "s + name + " distances differ"s;
+        }
+        for (size_t j = 0; j < expected_roads.size(); ++j) {
+            if (expected_roads[j].to != actual_roads[j].to || expected_roads[j].distance != actual_roads[j].distance
+                || expected_roads[j].is_explicit != actual_roads[j].is_explicit) {
+                return "Stop "s + name + " distances differ"s;
+            }
+        }
+    }
+    
+    for (size_t i = 0; i < expected.GetBusesData().size(); ++i) {
+        const catalogue::Bus& expected_bus = expected.GetBusesData()[i];
+        const catalogue::Bus& actual_bus = actual.GetBusesData()[i];
+        const std::string name = std::string(expected_bus.name) + " #"s + std::to_string(i);
+        if (expected.IsRemoved(&expected_bus) != actual.IsRemoved(&actual_bus)) {
+            return "Bus "s + name + " is indexed differently"s;
+        }
+        if (expected_bus.type != actual_bus.type || expected_bus.route.size() != actual_bus.route.size()) {
+            return "Bus "s + name + " route differs"s;
+        }
+        for (size_t j = 0; j < expected_bus.route.size(); ++j) {
+            if (expected_bus.route[j]->id != actual_bus.route[j]->id) {
+                return "Bus "s + name + " route differs"s;
+            }
+        }
+        const catalogue::BusStats& expected_stats = expected.GetBusStats(&expected_bus);
+        const catalogue::BusStats& actual_stats = actual.GetBusStats(&actual_bus);
+        if (expected_stats.route_length != actual_stats.route_length
+            || expected_stats.unique_stop_count != actual_stats.unique_stop_count) {
+            return "Bus "s + name + " stats differ"s;
+        }
+    }
+    return {};
+}
+
+std::string RoundTrip(void (*fill)(TransportCatalogue&), const std::filesystem::path& path) {
+    TransportCatalogue expected;
+    fill(expected);
+    serialization::Save(path, expected, nullptr, nullptr);
+    
+    TransportCatalogue actual;
+    const io::MappedFile file(path);
+    serialization::Load(file, actual);
+    return Compare(expected, actual);
+}
+
+} // namespace
+
+int main() {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "serialization_round_trip.bin";
+    const std::pair<std::string_view, void (*)(TransportCatalogue&)> cases[] = {
+        {"duplicated names"sv, FillDuplicatedNames},
+        {"removed names"sv, FillRemovedNames},
+    };
+    
+    int error_count = 0;
+    for (const auto& [name, fill] : cases) {
+        try {
+            if (const std::string error = RoundTrip(fill, path); !error.empty()) {
+                std::cerr << name << ": "sv << error << '\n';
+                ++error_count;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << name << ": "sv << e.what() << '\n';
+            ++error_count;
+        }
+    }
+    std::filesystem::remove(path);
+    
+    if (error_count > 0) {
+        std::cerr << "FAILED: "sv << error_count << " of "sv << std::size(cases) << " cases\n"sv;
+        return 1;
+    }
+    std::cout << "ok: "sv << std::size(cases) << " cases\n"sv;
+}
@@ -0,0 +1,173 @@
+/*
+ * Нагрузочная проверка service::TransportService: поток-писатель публикует версии базы, меняя расстояние
+ * на проверочном маршруте и маршруты остальных автобусов, а потоки-читатели всё это время отвечают
+ * на запросы по закреплённым версиям. В каждой версии ответ маршрутизатора должен совпадать
+ * со справочником той же версии. Запускается под ThreadSanitizer: гонок быть не должно.
+ *
+ * Сборка и запуск из каталога transport-catalogue:
+ *     g++ -std=c++20 -O1 -g -fsanitize=thread -I. -Itransport_router transport_catalogue.cpp string_pool.cpp \
+ *         geo.cpp transport_router/transport_router.cpp transport_service.cpp tests/transport_service_stress.cpp \
+ *         -o transport_service_stress -lpthread
+ *     ./transport_service_stress
+ */
+
+#include "transport_service.h"
+
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+constexpr size_t STOP_COUNT = 100;
+constexpr size_t BUS_COUNT = 10;
+constexpr size_t BUS_STOPS = 10;
+constexpr size_t UPDATE_COUNT = 200;
+constexpr size_t READER_COUNT = 4;
+
+constexpr int WAIT_TIME = 6;
+constexpr double VELOCITY = 500.0; // м/мин
+
+// проверочный автобус ходит туда и обратно между двумя остановками, через которые больше никто не ездит
+constexpr std::string_view PROBE_BUS = "Probe"sv;
+constexpr std::string_view PROBE_FROM = "Probe A"sv;
+constexpr std::string_view PROBE_TO = "Probe B"sv;
+constexpr int PROBE_BACK_DISTANCE = 1000;
+
+std::string MakeStopName(size_t index) {
+    return "Stop "s + std::to_string(index);
+}
+
+std::vector<std::string> MakeRoute(std::mt19937& random) {
+    std::uniform_int_distribution<size_t> stop_index(0, STOP_COUNT - 1);
+    std::vector<std::string> route;
+    for (size_t i = 0; i < BUS_STOPS; ++i) {
+        route.push_back(MakeStopName(stop_index(random)));
+    }
+    return route;
+}
+
+std::vector<std::string_view> ToViews(const std::vector<std::string>& route) {
+    return {route.begin(), route.end()};
+}
+
+std::unique_ptr<service::Base> MakeInitialBase(std::mt19937& random) {
+    std::uniform_real_distribution<double> offset(0.0, 0.05);
+    std::uniform_int_distribution<int> distance(500, 3000);
+    
+    auto base = std::make_unique<service::Base>();
+    catalogue::TransportCatalogue& catalogue = base->catalogue;
+    for (size_t i = 0; i < STOP_COUNT; ++i) {
+        catalogue.AddStop(MakeStopName(i), {55.7 + offset(random), 37.5 + offset(random)});
+    }
+    // расстояния заданы между всеми парами, поэтому писатель может провести автобус через любые остановки
+    for (size_t i = 0; i < STOP_COUNT; ++i) {
+        for (size_t j = 0; j < STOP_COUNT; ++j) {
+            catalogue.AddDistance(MakeStopName(i), MakeStopName(j), distance(random));
+        }
+    }
+    for (size_t bus = 0; bus < BUS_COUNT; ++bus) {
+        catalogue.AddBus("Bus "s + std::to_string(bus), ToViews(MakeRoute(random)), false);
+    }
+    
+    catalogue.AddStop(PROBE_FROM, {55.6, 37.4});
+    catalogue.AddStop(PROBE_TO, {55.61, 37.41});
+    catalogue.AddDistance(PROBE_FROM, PROBE_TO, 1000);
+    catalogue.AddDistance(PROBE_TO, PROBE_FROM, PROBE_BACK_DISTANCE);
+    catalogue.AddBus(PROBE_BUS, {PROBE_FROM, PROBE_TO}, false);
+    
+    router::RoutingSettings settings;
+    settings.wait_time = WAIT_TIME;
+    settings.velocity = VELOCITY;
+    settings.router_type = router::RouterType::DIJKSTRA;
+    settings.cache_capacity = 64;
+    base->router = std::make_unique<router::TransportRouter>(std::move(settings), catalogue);
+    return base;
+}
+
+// возвращает описание несоответствия или пустую строку
+std::string CheckVersion(const service::Base& base, std::mt19937& random) {
+    const catalogue::TransportCatalogue& catalogue = base.catalogue;
+    if (base.router->GetVersion() != catalogue.GetVersion()) {
+        return "router version "s + std::to_string(base.router->GetVersion()) + " != catalogue version "s
+             + std::to_string(catalogue.GetVersion());
+    }
+    
+    const int distance = catalogue.GetDistanceBetweenStops(catalogue.GetStop(PROBE_FROM), catalogue.GetStop(PROBE_TO));
+    const auto route = base.router->BuildRoute(PROBE_FROM, PROBE_TO);
+    if (!route || std::abs(route->weight - (WAIT_TIME + distance / VELOCITY)) > 1e-9) {
+        return "probe route doesn't match distance "s + std::to_string(distance);
+    }
+    // некольцевой маршрут: туда и обратно
+    if (catalogue.GetBusStats(catalogue.GetBus(PROBE_BUS)).route_length != distance + PROBE_BACK_DISTANCE) {
+        return "probe bus length doesn't match distance "s + std::to_string(distance);
+    }
+    
+    // остальные запросы нагружают маршрутизатор и его кэш
+    std::uniform_int_distribution<size_t> stop_index(0, STOP_COUNT - 1);
+    for (int i = 0; i < 4; ++i) {
+        base.router->BuildRoute(MakeStopName(stop_index(random)), MakeStopName(stop_index(random)));
+    }
+    return {};
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 random(1);
+    service::TransportService transport_service(MakeInitialBase(random));
+    
+    std::atomic<bool> is_writing = true;
+    std::atomic<size_t> read_count = 0;
+    std::atomic<size_t> error_count = 0;
+    
+    std::vector<std::jthread> readers;
+    for (size_t i = 0; i < READER_COUNT; ++i) {
+        readers.emplace_back([&, i] {
+            service::TransportService::Reader reader(transport_service.GetVersions());
+            std::mt19937 reader_random(static_cast<unsigned>(i + 2));
+            // хотя бы одно чтение после последней публикации
+            for (bool is_last = false; !is_last;) {
+                is_last = !is_writing.load();
+                const auto base = reader.Pin();
+                if (const std::string error = CheckVersion(*base, reader_random); !error.empty()) {
+                    if (error_count++ == 0) {
+                        std::cerr << error << '\n';
+                    }
+                }
+                ++read_count;
+            }
+        });
+    }
+    
+    std::uniform_int_distribution<int> probe_distance(100, 10000);
+    std::uniform_int_distribution<size_t> bus_index(0, BUS_COUNT - 1);
+    std::uniform_real_distribution<double> offset(0.0, 0.05);
+    for (size_t update = 0; update < UPDATE_COUNT; ++update) {
+        const int distance = probe_distance(random);
+        const std::string bus = "Bus "s + std::to_string(bus_index(random));
+        const std::vector<std::string> route = MakeRoute(random);
+        const std::string stop = MakeStopName(update % STOP_COUNT);
+        const geo::Coordinates coords{55.7 + offset(random), 37.5 + offset(random)};
+        
+        transport_service.Update([&](catalogue::TransportCatalogue& catalogue) {
+            catalogue.UpdateDistance(PROBE_FROM, PROBE_TO, distance);
+            catalogue.UpdateBus(bus, ToViews(route), false);
+            catalogue.UpdateStop(stop, geo::Coordinates(coords));
+        });
+    }
+    is_writing = false;
+    readers.clear();
+    
+    if (error_count > 0) {
+        std::cerr << "FAILED: "sv << error_count << " of "sv << read_count << " reads\n"sv;
+        return 1;
+    }
+    std::cout << "ok: "sv << UPDATE_COUNT << " versions, "sv << read_count << " reads\n"sv;
+}
@@ -1,65 +1,403 @@
 #include "transport_catalogue.h"
 
 #include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace std::literals;
 
 namespace catalogue {
 
+namespace {
+
+template <typename Neighbours>
+auto FindNeighbour(Neighbours& neighbours, StopId to) {
+    return std::lower_bound(neighbours.begin(), neighbours.end(), to,
+                            [](const TransportCatalogue::RoadDistance& lhs, StopId rhs) { return lhs.to < rhs; });
+}
+
+// отзеркаливает некольцевой маршрут: A-B-C превращается в A-B-C-B-A
+void MirrorRoute(std::vector<const Stop*>& route) {
+    if (!route.empty()) {
+        for (size_t i = route.size() - 1; i-- > 0;) {
+            route.push_back(route[i]);
+        }
+    }
+}
+
+} // namespace
+
+TransportCatalogue::TransportCatalogue(const TransportCatalogue& other)
+    : names_(other.names_), stop_by_name_(other.stop_by_name_), bus_by_name_(other.bus_by_name_)
+    , stops_(other.stops_), stop_points_(other.stop_points_), buses_(other.buses_)
+    , distances_(other.distances_), route_distances_(other.route_distances_), bus_stats_(other.bus_stats_), min_max_coords_(other.min_max_coords_)
+    , changes_(other.changes_), discarded_changes_(other.discarded_changes_) {
+    
+    // скопированные указатели и названия ведут в other: перестраиваем их на свои объекты, а символы те же
+    for (Stop& stop : stops_) {
+        stop.name = names_.Get(stop.symbol);
+    }
+    for (Bus& bus : buses_) {
+        bus.name = names_.Get(bus.symbol);
+        for (const Stop*& stop : bus.route) {
+            stop = &stops_[stop->id];
+        }
+    }
+}
+
 const Stop* TransportCatalogue::GetStop(std::string_view key) const {
-    auto it = stops_view_.find(key);
-    return it != stops_view_.end() ? it->second : nullptr;
+    return GetStop(names_.Find(key));
+}
+
+const Stop* TransportCatalogue::GetStop(intern::Symbol symbol) const {
+    return symbol < stop_by_name_.size() && stop_by_name_[symbol] != NO_ID ? &stops_[stop_by_name_[symbol]] : nullptr;
 }
 
 const Bus* TransportCatalogue::GetBus(std::string_view key) const {
-    auto it = buses_view_.find(key);
-    return it != buses_view_.end() ? it->second : nullptr;
+    return GetBus(names_.Find(key));
+}
+
+const Bus* TransportCatalogue::GetBus(intern::Symbol symbol) const {
+    return symbol < bus_by_name_.size() && bus_by_name_[symbol] != NO_ID ? &buses_[bus_by_name_[symbol]] : nullptr;
 }
 
 int TransportCatalogue::GetDistanceBetweenStops(const Stop* from, const Stop* to) const {
-    // если расстояние from-to не задано явно, значит оно равно to-from
-    auto it = distances_.find(std::pair(from, to));
-    return it != distances_.end() ? it->second
-                                  : (it = distances_.find(std::pair(to, from))) != distances_.end() ? it->second : 0;
+    return GetDistanceBetweenStops(from->id, to->id);
+}
+
+int TransportCatalogue::GetDistanceBetweenStops(StopId from, StopId to) const {
+    const std::vector<RoadDistance>& neighbours = distances_[from];
+    auto it = FindNeighbour(neighbours, to);
+    return it != neighbours.end() && it->to == to ? it->distance : 0;
+}
+
+const BusStats& TransportCatalogue::GetBusStats(const Bus* bus) const {
+    return bus_stats_[bus->id];
+}
+
+void TransportCatalogue::AddStop(std::string_view id, geo::Coordinates&& coords) {
+    const intern::Symbol symbol = InternName(id);
+    Stop& ref = stops_.emplace_back(names_.Get(symbol), std::move(coords));
+    ref.id = static_cast<StopId>(stops_.size() - 1);
+    ref.symbol = symbol;
+    // при повторном названии поиск по-прежнему находит первую остановку
+    if (stop_by_name_[symbol] == NO_ID) {
+        stop_by_name_[symbol] = ref.id;
+    }
+    stop_points_.Add(ref.coords);
+    distances_.emplace_back();
+    LogChange(ChangeType::STOP_ADDED, ref.id);
+}
+
+void TransportCatalogue::AddDistance(std::string_view source, std::string_view destination, int distance) {
+    const Stop& from = GetMutableStop(source);
+    const Stop& to = GetMutableStop(destination);
+    
+    if (InsertDistance(from.id, to.id, distance)) {
+        LogChange(ChangeType::DISTANCE_CHANGED, from.id, to.id);
+        UpdateRouteLengths(&from);
+    }
+}
+
+void TransportCatalogue::AddBus(std::string_view id, std::vector<std::string_view>&& route, bool is_ring) {
+    std::vector<const Stop*> stop_ptrs = MakeRoute(route, is_ring);
+    
+    const intern::Symbol symbol = InternName(id);
+    Bus& ref = buses_.emplace_back(names_.Get(symbol), std::vector<const Stop*>(), is_ring ? RouteType::RING : RouteType::PENDULUM);
+    ref.id = static_cast<BusId>(buses_.size() - 1);
+    ref.symbol = symbol;
+    if (bus_by_name_[symbol] == NO_ID) {
+        bus_by_name_[symbol] = ref.id;
+    }
+    route_distances_.emplace_back();
+    bus_stats_.emplace_back();
+    
+    SetRoute(ref, std::move(stop_ptrs));
+    LogChange(ChangeType::BUS_ADDED, ref.id);
+}
+
+void TransportCatalogue::UpdateStop(std::string_view id, geo::Coordinates&& coords) {
+    Stop& stop = GetMutableStop(id);
+    stop.coords = std::move(coords);
+    stop_points_.Set(stop.id, stop.coords);
+    
+    for (BusId bus : stop.passing_buses) {
+        UpdateRouteGeoLength(&buses_[bus]);
+    }
+    if (!stop.passing_buses.empty()) {
+        RecalculateMinMaxCoords();
+    }
+    LogChange(ChangeType::STOP_MOVED, stop.id);
 }
 
-void TransportCatalogue::AddStop(const std::string& id, geo::Coordinates&& coords) {
-    const Stop& ref = stops_.emplace_back(id, std::move(coords));
-    stops_view_.emplace(ref.name, &ref);
+void TransportCatalogue::RemoveStop(std::string_view id) {
+    Stop& stop = GetMutableStop(id);
+    if (!stop.passing_buses.empty()) {
+        throw std::logic_error("Stop "s + std::string(stop.name) + " is used by buses"s);
+    }
+    
+    // у каждой записи о расстоянии есть парная запись у соседа: её тоже нужно убрать
+    for (const RoadDistance& road : distances_[stop.id]) {
+        if (road.to != stop.id) {
+            std::vector<RoadDistance>& reverse_neighbours = distances_[road.to];
+            reverse_neighbours.erase(FindNeighbour(reverse_neighbours, stop.id));
+        }
+    }
+    distances_[stop.id].clear();
+    
+    stop_by_name_[stop.symbol] = NO_ID;
+    LogChange(ChangeType::STOP_REMOVED, stop.id);
+}
+
+void TransportCatalogue::UpdateDistance(std::string_view source, std::string_view destination, int distance) {
+    const Stop& from = GetMutableStop(source);
+    const Stop& to = GetMutableStop(destination);
+    
+    std::vector<RoadDistance>& neighbours = distances_[from.id];
+    if (auto it = FindNeighbour(neighbours, to.id); it == neighbours.end() || it->to != to.id) {
+        neighbours.insert(it, {to.id, distance, true});
+    } else {
+        *it = {to.id, distance, true};
+    }
+    
+    // обратное направление, не заданное явно, следует за прямым
+    std::vector<RoadDistance>& reverse_neighbours = distances_[to.id];
+    if (auto it = FindNeighbour(reverse_neighbours, from.id); it == reverse_neighbours.end() || it->to != from.id) {
+        reverse_neighbours.insert(it, {from.id, distance, false});
+    } else if (!it->is_explicit) {
+        it->distance = distance;
+    }
+    
+    LogChange(ChangeType::DISTANCE_CHANGED, from.id, to.id);
+    UpdateRouteLengths(&from);
+}
+
+void TransportCatalogue::RemoveDistance(std::string_view source, std::string_view destination) {
+    const Stop& from = GetMutableStop(source);
+    const Stop& to = GetMutableStop(destination);
+    
+    // удалять можно только явно заданное расстояние
+    std::vector<RoadDistance>& neighbours = distances_[from.id];
+    auto it = FindNeighbour(neighbours, to.id);
+    if (it == neighbours.end() || it->to != to.id || !it->is_explicit) {
+        return;
+    }
+    
+    std::vector<RoadDistance>& reverse_neighbours = distances_[to.id];
+    if (from.id == to.id) {
+        neighbours.erase(it);
+    } else if (auto reverse_it = FindNeighbour(reverse_neighbours, from.id); reverse_it->is_explicit) {
+        *it = {to.id, reverse_it->distance, false};
+    } else {
+        neighbours.erase(it);
+        reverse_neighbours.erase(reverse_it);
+    }
+    
+    LogChange(ChangeType::DISTANCE_CHANGED, from.id, to.id);
+    UpdateRouteLengths(&from);
+}
+
+void TransportCatalogue::UpdateBus(std::string_view id, std::vector<std::string_view>&& route, bool is_ring) {
+    Bus& bus = GetMutableBus(id);
+    std::vector<const Stop*> stop_ptrs = MakeRoute(route, is_ring);
+    
+    bus.type = is_ring ? RouteType::RING : RouteType::PENDULUM;
+    SetRoute(bus, std::move(stop_ptrs));
+    // прежние остановки могли остаться без автобусов
+    RecalculateMinMaxCoords();
+    LogChange(ChangeType::BUS_CHANGED, bus.id);
+}
+
+void TransportCatalogue::RemoveBus(std::string_view id) {
+    Bus& bus = GetMutableBus(id);
+    SetRoute(bus, {});
+    bus_stats_[bus.id] = BusStats();
+    
+    bus_by_name_[bus.symbol] = NO_ID;
+    RecalculateMinMaxCoords();
+    LogChange(ChangeType::BUS_REMOVED, bus.id);
+}
+
+bool TransportCatalogue::IsRemoved(const Stop* stop) const {
+    return GetStop(stop->symbol) != stop;
+}
+
+bool TransportCatalogue::IsRemoved(const Bus* bus) const {
+    return GetBus(bus->symbol) != bus;
+}
+
+void TransportCatalogue::HideStop(StopId id) {
+    const Stop& stop = stops_.at(id);
+    if (stop_by_name_[stop.symbol] == id) {
+        stop_by_name_[stop.symbol] = NO_ID;
+        LogChange(ChangeType::STOP_REMOVED, id);
+    }
+}
+
+void TransportCatalogue::HideBus(BusId id) {
+    const Bus& bus = buses_.at(id);
+    if (bus_by_name_[bus.symbol] == id) {
+        bus_by_name_[bus.symbol] = NO_ID;
+        LogChange(ChangeType::BUS_REMOVED, id);
+    }
 }
 
-void TransportCatalogue::AddDistance(const std::string& source, const std::string_view destination, int distance) {
-    distances_.emplace(std::pair(GetStop(source), GetStop(destination)), distance);
+std::span<const Change> TransportCatalogue::GetChanges(size_t version) const {
+    if (version < discarded_changes_ || version > GetVersion()) {
+        throw std::out_of_range("Changes since version "s + std::to_string(version) + " are not available"s);
+    }
+    return std::span<const Change>(changes_).subspan(version - discarded_changes_);
 }
 
-void TransportCatalogue::AddBus(const std::string& id, std::vector<std::string_view>&& route, bool is_ring) {
+void TransportCatalogue::DiscardChanges(size_t version) {
+    version = std::min(version, GetVersion());
+    if (version > discarded_changes_) {
+        changes_.erase(changes_.begin(), changes_.begin() + (version - discarded_changes_));
+        discarded_changes_ = version;
+    }
+}
+
+Stop& TransportCatalogue::GetMutableStop(std::string_view id) {
+    const Stop* stop = GetStop(id);
+    if (!stop) {
+        throw std::out_of_range("Unknown stop "s + std::string(id));
+    }
+    return stops_[stop->id];
+}
+
+Bus& TransportCatalogue::GetMutableBus(std::string_view id) {
+    const Bus* bus = GetBus(id);
+    if (!bus) {
+        throw std::out_of_range("Unknown bus "s + std::string(id));
+    }
+    return buses_[bus->id];
+}
+
+intern::Symbol TransportCatalogue::InternName(std::string_view name) {
+    const intern::Symbol symbol = names_.Intern(name);
+    if (symbol >= stop_by_name_.size()) {
+        stop_by_name_.resize(names_.Size(), NO_ID);
+        bus_by_name_.resize(names_.Size(), NO_ID);
+    }
+    return symbol;
+}
+
+bool TransportCatalogue::InsertDistance(StopId from, StopId to, int distance) {
+    // явно заданное расстояние не меняется, а записанное по обратному направлению заменяется явным
+    std::vector<RoadDistance>& neighbours = distances_[from];
+    if (auto it = FindNeighbour(neighbours, to); it == neighbours.end() || it->to != to) {
+        neighbours.insert(it, {to, distance, true});
+    } else if (!it->is_explicit) {
+        *it = {to, distance, true};
+    } else {
+        return false;
+    }
+    
+    std::vector<RoadDistance>& reverse_neighbours = distances_[to];
+    if (auto it = FindNeighbour(reverse_neighbours, from); it == reverse_neighbours.end() || it->to != from) {
+        reverse_neighbours.insert(it, {from, distance, false});
+    }
+    return true;
+}
+
+std::vector<const Stop*> TransportCatalogue::MakeRoute(const std::vector<std::string_view>& route, bool is_ring) const {
     // маршрут строится как последовательность указателей на соответствующие названиям из route остановки.
     std::vector<const Stop*> stop_ptrs;
-    stop_ptrs.reserve(is_ring ? route.size() : 2 * route.size() - 1);
+    stop_ptrs.reserve(is_ring || route.empty() ? route.size() : 2 * route.size() - 1);
     for (std::string_view stop : route) {
         const Stop* stop_ptr = GetStop(stop);
+        if (!stop_ptr) {
+            throw std::out_of_range("Unknown stop "s + std::string(stop));
+        }
         stop_ptrs.push_back(stop_ptr);
-        
-        // обновляем здесь, чтобы при рендеринге не учитывать остановки без автобусов; сначала min...
-        min_max_coords_.min.lat = std::min(min_max_coords_.min.lat, stop_ptr->coords.lat);
-        min_max_coords_.min.lng = std::min(min_max_coords_.min.lng, stop_ptr->coords.lng);
-        // ...потом max
-        min_max_coords_.max.lat = std::max(min_max_coords_.max.lat, stop_ptr->coords.lat);
-        min_max_coords_.max.lng = std::max(min_max_coords_.max.lng, stop_ptr->coords.lng);
-    }
-    // отзеркалим некольцевые маршруты
+    }
     if (!is_ring) {
-        for (auto it = stop_ptrs.rbegin() + 1; it != stop_ptrs.rend(); ++it) {
-            stop_ptrs.push_back(*it);
+        MirrorRoute(stop_ptrs);
+    }
+    return stop_ptrs;
+}
+
+void TransportCatalogue::SetRoute(Bus& bus, std::vector<const Stop*>&& route) {
+    for (const Stop* stop : bus.route) {
+        std::vector<BusId>& buses = stops_[stop->id].passing_buses;
+        if (auto it = std::lower_bound(buses.begin(), buses.end(), bus.id); it != buses.end() && *it == bus.id) {
+            buses.erase(it);
+        }
+    }
+    bus.route = std::move(route);
+    for (const Stop* stop : bus.route) {
+        // новый автобус получает наибольший номер, поэтому при загрузке вставка всегда идёт в конец списка,
+        // а повторное прохождение остановки (в том числе обратный ход некольцевого маршрута) отсекается сравнением
+        std::vector<BusId>& buses = stops_[stop->id].passing_buses;
+        if (auto it = std::lower_bound(buses.begin(), buses.end(), bus.id); it == buses.end() || *it != bus.id) {
+            buses.insert(it, bus.id);
         }
+        // обновляем здесь, чтобы при рендеринге не учитывать остановки без автобусов
+        ExtendMinMaxCoords(stop);
     }
     
-    const Bus& ref = buses_.emplace_back(id, std::move(stop_ptrs), is_ring ? RouteType::RING : RouteType::PENDULUM);
-    buses_view_.emplace(ref.name, &ref);
+    BusStats& stats = bus_stats_[bus.id];
+    stats.stop_count = static_cast<int>(bus.route.size());
+    stats.unique_stop_count = CountUniqueStops(&bus);
+    stats.geo_length = CalculateRouteGeoLength(&bus);
+    UpdateRouteLength(&bus);
+}
+
+void TransportCatalogue::UpdateRouteDistances(const Bus* bus) {
+    std::vector<int>& distances = route_distances_[bus->id];
+    distances.resize(bus->route.size());
     
-    for (const Stop* stop : ref.route) {
-        const_cast<Stop*>(stop)->passing_buses.insert(ref.name);
+    int distance = 0;
+    for (size_t i = 0; i < bus->route.size(); ++i) {
+        if (i > 0) {
+            distance += GetDistanceBetweenStops(bus->route[i - 1], bus->route[i]);
+        }
+        distances[i] = distance;
+    }
+}
+
+void TransportCatalogue::UpdateRouteLength(const Bus* bus) {
+    UpdateRouteDistances(bus);
+    BusStats& stats = bus_stats_[bus->id];
+    stats.route_length = CalculateRouteLength(bus);
+    stats.curvature = static_cast<double>(stats.route_length) / stats.geo_length;
+}
+
+void TransportCatalogue::UpdateRouteGeoLength(const Bus* bus) {
+    BusStats& stats = bus_stats_[bus->id];
+    stats.geo_length = CalculateRouteGeoLength(bus);
+    stats.curvature = static_cast<double>(stats.route_length) / stats.geo_length;
+}
+
+void TransportCatalogue::UpdateRouteLengths(const Stop* stop) {
+    // маршрут с перегоном, начинающимся в stop, проходит и через stop
+    for (BusId bus : stop->passing_buses) {
+        UpdateRouteLength(&buses_[bus]);
+    }
+}
+
+void TransportCatalogue::ExtendMinMaxCoords(const Stop* stop) {
+    // сначала min...
+    min_max_coords_.min.lat = std::min(min_max_coords_.min.lat, stop->coords.lat);
+    min_max_coords_.min.lng = std::min(min_max_coords_.min.lng, stop->coords.lng);
+    // ...потом max
+    min_max_coords_.max.lat = std::max(min_max_coords_.max.lat, stop->coords.lat);
+    min_max_coords_.max.lng = std::max(min_max_coords_.max.lng, stop->coords.lng);
+}
+
+void TransportCatalogue::RecalculateMinMaxCoords() {
+    min_max_coords_ = {{DBL_MAX, DBL_MAX}, {-DBL_MAX, -DBL_MAX}};
+    for (const Stop& stop : stops_) {
+        if (!stop.passing_buses.empty()) {
+            ExtendMinMaxCoords(&stop);
+        }
     }
 }
 
+void TransportCatalogue::LogChange(ChangeType type, uint32_t id, StopId to) {
+    changes_.push_back({type, id, to});
+}
+
 int TransportCatalogue::CountUniqueStops(const Bus* bus) {
     std::vector<const Stop*> sorted(bus->route);
     std::sort(sorted.begin(), sorted.end());
@@ -76,20 +414,158 @@ int TransportCatalogue::CountUniqueStops(const Bus* bus) {
     return unique;
 }
 
-double TransportCatalogue::CalculateRouteGeoLength(const Bus* bus) {
+double TransportCatalogue::CalculateRouteGeoLength(const Bus* bus) const {
+    if (bus->route.size() < 2) {
+        return 0.0;
+    }
+    
+    std::vector<StopId> path;
+    path.reserve(bus->route.size());
+    for (const Stop* stop : bus->route) {
+        path.push_back(stop->id);
+    }
+    std::vector<double> lengths(path.size() - 1);
+    stop_points_.ComputeDistances(path, lengths);
+    
     double length = 0.0;
-    for (auto curr = bus->route.begin(), next = curr + 1; next != bus->route.end(); ++curr, ++next) {
-        length += geo::ComputeDistance((*curr)->coords, (*next)->coords);
+    for (double segment : lengths) {
+        length += segment;
     }
     return length;
 }
 
 int TransportCatalogue::CalculateRouteLength(const Bus* bus) const {
-    int length = 0;
-    for (auto curr = bus->route.begin(), next = curr + 1; next != bus->route.end(); ++curr, ++next) {
-        length += GetDistanceBetweenStops(*curr, *next);
+    const std::vector<int>& distances = route_distances_[bus->id];
+    return distances.empty() ? 0 : distances.back();
+}
+
+// ---------- Загрузка целиком ------------------
+
+void TransportCatalogue::Builder::AddStop(std::string_view id, geo::Coordinates coords) {
+    last_stop_ = names_.Intern(id);
+    stops_.push_back({last_stop_, coords});
+}
+
+void TransportCatalogue::Builder::AddDistance(std::string_view source, std::string_view destination, int distance) {
+    // расстояния обычно идут сразу за своей остановкой: её название уже в кеше, и хешировать его не нужно
+    const intern::Symbol from = last_stop_ != intern::NO_SYMBOL && names_.Get(last_stop_) == source
+                                ? last_stop_ : names_.Intern(source);
+    distances_.push_back({from, names_.Intern(destination), distance});
+}
+
+void TransportCatalogue::Builder::AddBus(std::string_view id, std::span<const std::string_view> route, bool is_ring) {
+    const uint32_t route_begin = static_cast<uint32_t>(route_stops_.size());
+    for (std::string_view stop : route) {
+        route_stops_.push_back(names_.Intern(stop));
     }
-    return length;
+    buses_.push_back({names_.Intern(id), route_begin, static_cast<uint32_t>(route_stops_.size()), is_ring});
+}
+
+void TransportCatalogue::Builder::Build(TransportCatalogue& catalogue) {
+    if (!catalogue.stops_.empty() || !catalogue.buses_.empty()) {
+        throw std::logic_error("Catalogue must be empty before bulk load"s);
+    }
+    
+    catalogue.names_ = std::move(names_);
+    const intern::StringPool& names = catalogue.names_;
+    catalogue.stop_by_name_.assign(names.Size(), NO_ID);
+    catalogue.bus_by_name_.assign(names.Size(), NO_ID);
+    
+    // остановки: при повторном названии поиск находит первую, как и после AddStop
+    catalogue.stop_points_.Reserve(stops_.size());
+    for (const StopRecord& record : stops_) {
+        Stop& stop = catalogue.stops_.emplace_back(names.Get(record.name), record.coords);
+        stop.id = static_cast<StopId>(catalogue.stops_.size() - 1);
+        stop.symbol = record.name;
+        if (catalogue.stop_by_name_[record.name] == NO_ID) {
+            catalogue.stop_by_name_[record.name] = stop.id;
+        }
+        catalogue.stop_points_.Add(stop.coords);
+    }
+    
+    auto stop_id = [&catalogue, &names](intern::Symbol name) {
+        const StopId id = catalogue.stop_by_name_[name];
+        if (id == NO_ID) {
+            throw std::out_of_range("Unknown stop "s + std::string(names.Get(name)));
+        }
+        return id;
+    };
+    
+    // расстояния: списки соседей получают ёмкость с запасом на повторы, а вставка идёт по правилам AddDistance
+    std::vector<uint32_t> counts(stops_.size(), 0);
+    for (const DistanceRecord& record : distances_) {
+        ++counts[stop_id(record.from)];
+        ++counts[stop_id(record.to)];
+    }
+    catalogue.distances_.resize(stops_.size());
+    for (StopId id = 0; id < counts.size(); ++id) {
+        catalogue.distances_[id].reserve(counts[id]);
+    }
+    for (const DistanceRecord& record : distances_) {
+        catalogue.InsertDistance(stop_id(record.from), stop_id(record.to), record.distance);
+    }
+    
+    // маршруты; заодно считаем, сколько разных автобусов проходит через каждую остановку
+    // и сколько разных остановок у каждого маршрута
+    std::fill(counts.begin(), counts.end(), 0);
+    std::vector<BusId> last_bus(stops_.size(), NO_ID);
+    catalogue.route_distances_.resize(buses_.size());
+    catalogue.bus_stats_.resize(buses_.size());
+    for (const BusRecord& record : buses_) {
+        Bus& bus = catalogue.buses_.emplace_back(names.Get(record.name), std::vector<const Stop*>(),
+                                                 record.is_ring ? RouteType::RING : RouteType::PENDULUM);
+        bus.id = static_cast<BusId>(catalogue.buses_.size() - 1);
+        bus.symbol = record.name;
+        if (catalogue.bus_by_name_[record.name] == NO_ID) {
+            catalogue.bus_by_name_[record.name] = bus.id;
+        }
+        
+        const size_t stop_count = record.route_end - record.route_begin;
+        bus.route.reserve(record.is_ring || stop_count == 0 ? stop_count : 2 * stop_count - 1);
+        BusStats& stats = catalogue.bus_stats_[bus.id];
+        for (uint32_t i = record.route_begin; i < record.route_end; ++i) {
+            const StopId id = stop_id(route_stops_[i]);
+            bus.route.push_back(&catalogue.stops_[id]);
+            if (last_bus[id] != bus.id) {
+                last_bus[id] = bus.id;
+                ++counts[id];
+                ++stats.unique_stop_count;
+            }
+        }
+        if (!record.is_ring) {
+            MirrorRoute(bus.route);
+        }
+    }
+    
+    // номера автобусов идут по возрастанию, поэтому списки сразу получаются упорядоченными
+    for (Stop& stop : catalogue.stops_) {
+        stop.passing_buses.reserve(counts[stop.id]);
+    }
+    for (const Bus& bus : catalogue.buses_) {
+        for (const Stop* stop : bus.route) {
+            std::vector<BusId>& passing_buses = catalogue.stops_[stop->id].passing_buses;
+            if (passing_buses.empty() || passing_buses.back() != bus.id) {
+                passing_buses.push_back(bus.id);
+            }
+        }
+    }
+    
+    // сводки считаются один раз, когда все расстояния уже известны
+    for (const Bus& bus : catalogue.buses_) {
+        BusStats& stats = catalogue.bus_stats_[bus.id];
+        stats.stop_count = static_cast<int>(bus.route.size());
+        stats.geo_length = catalogue.CalculateRouteGeoLength(&bus);
+        catalogue.UpdateRouteLength(&bus);
+    }
+    catalogue.RecalculateMinMaxCoords();
+    
+    catalogue.discarded_changes_ = stops_.size() + distances_.size() + buses_.size();
+    
+    stops_.clear();
+    distances_.clear();
+    buses_.clear();
+    route_stops_.clear();
+    last_stop_ = intern::NO_SYMBOL;
 }
 
 } // namespace catalogue
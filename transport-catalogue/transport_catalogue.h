@@ -1,76 +1,238 @@
 #pragma once
 
 #include "geo.h"
+#include "string_pool.h"
 
 #include <cfloat>
+#include <cstdint>
 #include <deque>
-#include <set>
-#include <string>
-#include <unordered_map>
+#include <span>
+#include <string_view>
 #include <vector>
 
 namespace catalogue {
 
+// остановки и автобусы нумеруются подряд с нуля в порядке добавления
+using StopId = uint32_t;
+using BusId = uint32_t;
+
+/*
+ * Названия остановок и автобусов хранятся один раз в пуле справочника: name ссылается туда,
+ * а symbol -- символ названия в пуле, по которому сравниваются и ищутся объекты.
+ */
 struct Stop {
-    std::string name;
+    std::string_view name;
     geo::Coordinates coords;
-    std::set<std::string_view> passing_buses;
+    std::vector<BusId> passing_buses; // номера автобусов по возрастанию, без повторов
+    StopId id = 0;
+    intern::Symbol symbol = intern::NO_SYMBOL;
 };
 
 enum class RouteType { RING, PENDULUM };
 
 struct Bus {
-    std::string name;
+    std::string_view name;
     std::vector<const Stop*> route;
     RouteType type;
+    BusId id = 0;
+    intern::Symbol symbol = intern::NO_SYMBOL;
+};
+
+// сводка по маршруту для ответа на запрос "Bus"
+struct BusStats {
+    int stop_count = 0;
+    int unique_stop_count = 0;
+    int route_length = 0;      // по дорогам, в метрах
+    double geo_length = 0.0;   // по прямой между остановками
+    double curvature = 0.0;    // отношение длины по дорогам к длине по прямой
 };
 
+// вид изменения справочника в журнале изменений
+enum class ChangeType {
+    STOP_ADDED,
+    STOP_MOVED,
+    STOP_REMOVED,
+    DISTANCE_CHANGED, // id -- остановка, от которой задано расстояние, to -- остановка назначения
+    BUS_ADDED,
+    BUS_CHANGED,
+    BUS_REMOVED,
+};
+
+struct Change {
+    ChangeType type;
+    uint32_t id;      // номер остановки или автобуса
+    StopId to = 0;
+};
+
+/*
+ * Удалённые остановки и автобусы остаются в хранилище на своих местах, чтобы номера остальных не сдвигались:
+ * они пропадают из поиска по названию, у удалённой остановки нет расстояний и автобусов, а у удалённого
+ * автобуса -- маршрута. Название после удаления можно занять заново, новый объект получит новый номер.
+ */
 class TransportCatalogue {
 public:
     struct MinMaxCoords { geo::Coordinates min, max; };
     
-    struct StopPtrsHasher {
-        size_t operator()(const std::pair<const Stop*, const Stop*>& pair) const {
-            return hash(pair.first) + 31 * hash(pair.second);
-        }
-        
-        std::hash<const void*> hash;
+    /*
+     * Расстояние до соседней остановки. Если расстояние в обратную сторону не задано явно, оно равно прямому:
+     * такие записи добавляются сразу при загрузке, и при поиске второй просмотр не нужен.
+     */
+    struct RoadDistance {
+        StopId to;
+        int distance;
+        bool is_explicit;
     };
     
+    class Builder;
+    
     TransportCatalogue() = default;
-    TransportCatalogue(const TransportCatalogue&) = delete;
+    // копия с теми же номерами и журналом изменений, но со своими указателями: её можно менять независимо
+    TransportCatalogue(const TransportCatalogue& other);
     TransportCatalogue(TransportCatalogue&&) = delete;
     
     TransportCatalogue& operator=(const TransportCatalogue&) = delete;
     TransportCatalogue& operator=(TransportCatalogue&&) = delete;
     
+    // поиск по символу из GetNames() обходится без хеширования и сравнения строк
     const Stop* GetStop(std::string_view key) const;
+    const Stop* GetStop(intern::Symbol symbol) const;
     const Bus* GetBus(std::string_view key) const;
+    const Bus* GetBus(intern::Symbol symbol) const;
+    inline const intern::StringPool& GetNames() const { return names_; }
     int GetDistanceBetweenStops(const Stop* from, const Stop* to) const;
+    int GetDistanceBetweenStops(StopId from, StopId to) const;
+    // сводка считается при добавлении маршрута, поэтому запрос не зависит от его длины
+    const BusStats& GetBusStats(const Bus* bus) const;
+    // расстояния по дорогам от начала маршрута до каждой его остановки: длина отрезка -- одно вычитание
+    inline const std::vector<int>& GetRouteDistances(const Bus* bus) const { return route_distances_[bus->id]; }
     
     inline const std::deque<Stop>& GetStopsData() const { return stops_; };
     inline const std::deque<Bus>& GetBusesData() const { return buses_; };
+    // расстояния от остановки from, упорядоченные по номеру соседней остановки
+    inline const std::vector<RoadDistance>& GetRoadDistances(StopId from) const { return distances_[from]; };
     inline const MinMaxCoords& GetMinMaxCoords() const { return min_max_coords_; };
+    // координаты остановок по их номерам, с заранее посчитанной тригонометрией широты
+    inline const geo::Points& GetStopPoints() const { return stop_points_; };
+    
+    void AddStop(std::string_view id, geo::Coordinates&& coords);
+    // неизвестная или удалённая остановка -- std::out_of_range, как и в Builder::Build
+    void AddDistance(std::string_view source, std::string_view destination, int distance);
+    void AddBus(std::string_view id, std::vector<std::string_view>&& route, bool is_ring);
+    
+    /*
+     * Изменение и удаление уже добавленных данных; неизвестное название -- std::out_of_range.
+     * Эти операции не синхронизированы: читать справочник из других потоков, пока они выполняются,
+     * нельзя. Чтобы обновлять данные под нагрузкой, меняйте копию через service::TransportService --
+     * читатели продолжат работать со своей опубликованной версией.
+     */
+    void UpdateStop(std::string_view id, geo::Coordinates&& coords);
+    // через удаляемую остановку не должен проходить ни один автобус, иначе std::logic_error
+    void RemoveStop(std::string_view id);
+    // в отличие от AddDistance заменяет и явно заданное ранее расстояние
+    void UpdateDistance(std::string_view source, std::string_view destination, int distance);
+    // после удаления расстояние в эту сторону снова берётся из обратного направления, если оно задано
+    void RemoveDistance(std::string_view source, std::string_view destination);
+    void UpdateBus(std::string_view id, std::vector<std::string_view>&& route, bool is_ring);
+    void RemoveBus(std::string_view id);
+    
+    // удалённый объект или повтор уже занятого названия: поиск по названию к нему не ведёт
+    bool IsRemoved(const Stop* stop) const;
+    bool IsRemoved(const Bus* bus) const;
+    // для загрузки снимка: поиск по названию перестаёт вести к объекту с этим номером, а его данные остаются,
+    // как у повтора названия. В отличие от Remove* объект ищется по номеру, а не по названию
+    void HideStop(StopId id);
+    void HideBus(BusId id);
     
-    void AddStop(const std::string& id, geo::Coordinates&& coords);
-    void AddDistance(const std::string& source, const std::string_view destination, int distance);
-    void AddBus(const std::string& id, std::vector<std::string_view>&& route, bool is_ring);
+    /*
+     * Журнал изменений: каждая операция выше добавляет в него записи, а версия справочника -- число
+     * записей за всё время. Потребитель (например, маршрутизатор) запоминает версию, с которой он
+     * согласован, и потом забирает только более поздние изменения.
+     */
+    inline size_t GetVersion() const { return discarded_changes_ + changes_.size(); }
+    // изменения после версии version; если они уже отброшены -- std::out_of_range
+    std::span<const Change> GetChanges(size_t version) const;
+    // забывает изменения до версии version, которые больше никому не нужны
+    void DiscardChanges(size_t version);
     
     static int CountUniqueStops(const Bus* bus);
-    static double CalculateRouteGeoLength(const Bus* bus);
+    double CalculateRouteGeoLength(const Bus* bus) const;
+    // по GetRouteDistances, без поиска расстояний
     int CalculateRouteLength(const Bus* bus) const;
     
-private:    
+private:
+    Stop& GetMutableStop(std::string_view id);
+    Bus& GetMutableBus(std::string_view id);
+    intern::Symbol InternName(std::string_view name);
+    // true, если расстояние добавлено или заменило записанное по обратному направлению
+    bool InsertDistance(StopId from, StopId to, int distance);
+    std::vector<const Stop*> MakeRoute(const std::vector<std::string_view>& route, bool is_ring) const;
+    void SetRoute(Bus& bus, std::vector<const Stop*>&& route);
+    void UpdateRouteDistances(const Bus* bus);
+    void UpdateRouteLength(const Bus* bus);
+    void UpdateRouteGeoLength(const Bus* bus);
+    void UpdateRouteLengths(const Stop* stop);
+    void ExtendMinMaxCoords(const Stop* stop);
+    void RecalculateMinMaxCoords();
+    void LogChange(ChangeType type, uint32_t id, StopId to = 0);
+    
+    static constexpr uint32_t NO_ID = UINT32_MAX;
+    
+    // все названия; номер остановки или автобуса по символу названия (NO_ID, если такого нет)
+    intern::StringPool names_;
+    std::vector<StopId> stop_by_name_;
+    std::vector<BusId> bus_by_name_;
+    
     std::deque<Stop> stops_;
-    std::unordered_map<std::string_view, const Stop*> stops_view_;
+    geo::Points stop_points_;
     
     std::deque<Bus> buses_;
-    std::unordered_map<std::string_view, const Bus*> buses_view_;
     
-    std::unordered_map<std::pair<const Stop*, const Stop*>, int, StopPtrsHasher> distances_;
+    // у каждой остановки по номеру лежит короткий список соседей: поиск расстояния обходится без хеширования
+    std::vector<std::vector<RoadDistance>> distances_;
+    
+    // расстояние, добавленное после маршрутов, пересчитывает длину проходящих через него маршрутов
+    std::vector<std::vector<int>> route_distances_; // по номерам автобусов
+    std::vector<BusStats> bus_stats_;
     
     // для рендера: при обновлении справочника будем запоминать маргинальные координаты <min, max>
     MinMaxCoords min_max_coords_{{DBL_MAX, DBL_MAX}, {-DBL_MAX, -DBL_MAX}};
+    
+    std::vector<Change> changes_;
+    size_t discarded_changes_ = 0;
+};
+
+/*
+ * Загрузка справочника целиком. Остановки, расстояния и маршруты принимаются в любом порядке и только
+ * запоминаются: названия сразу попадают в пул, поэтому записи хранят символы, а не строки, а ссылки
+ * на ещё не встреченные остановки разрешаются в Build. Build переносит всё в пустой справочник несколькими
+ * линейными проходами: ёмкости известны заранее, а индексы по названиям, списки соседей и проходящих
+ * автобусов, сводки маршрутов и границы карты строятся по одному разу, без пересчёта после каждой записи.
+ *
+ * Результат тот же, что у AddStop, AddDistance и AddBus в порядке добавления (сначала все остановки,
+ * затем расстояния, затем маршруты). Только журнал изменений загрузку не перечисляет: версия справочника
+ * увеличивается на число записей, а сами записи считаются уже отброшенными.
+ */
+class TransportCatalogue::Builder {
+public:
+    void AddStop(std::string_view id, geo::Coordinates coords);
+    void AddDistance(std::string_view source, std::string_view destination, int distance);
+    void AddBus(std::string_view id, std::span<const std::string_view> route, bool is_ring);
+    
+    // справочник должен быть пуст, иначе std::logic_error; неизвестная остановка -- std::out_of_range.
+    // Накопленные записи переходят в справочник, после чего строитель снова пуст
+    void Build(TransportCatalogue& catalogue);
+    
+private:
+    struct StopRecord { intern::Symbol name; geo::Coordinates coords; };
+    struct DistanceRecord { intern::Symbol from, to; int distance; };
+    struct BusRecord { intern::Symbol name; uint32_t route_begin, route_end; bool is_ring; };
+    
+    intern::StringPool names_;
+    std::vector<StopRecord> stops_;
+    std::vector<DistanceRecord> distances_;
+    std::vector<BusRecord> buses_;
+    std::vector<intern::Symbol> route_stops_; // остановки всех маршрутов подряд
+    intern::Symbol last_stop_ = intern::NO_SYMBOL;
 };
 
 } // namespace catalogue
@@ -0,0 +1,474 @@
+#pragma once
+
+#include "router.h"
+#include "search_space.h"
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+/*
+ * Иерархия сжатия (contraction hierarchy): при построении вершины по очереди "сжимаются" в порядке
+ * важности, а кратчайшие пути через сжатую вершину сохраняются рёбрами-сокращениями. Запрос -- это
+ * двунаправленный поиск, который ходит только вверх по иерархии и просматривает малую часть графа.
+ * Каждое сокращение помнит два ребра, из которых оно составлено, поэтому путь раскрывается
+ * обратно в исходные EdgeId графа.
+ */
+template <typename Weight>
+class ContractionHierarchy final : public RouterBase<Weight> {
+private:
+    using Graph = CsrGraph<Weight>;
+    
+public:
+    using RouteInfo = typename RouterBase<Weight>::RouteInfo;
+    
+    explicit ContractionHierarchy(const Graph& graph);
+    
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+    
+    inline size_t GetShortcutCount() const { return edges_.size() - original_edge_count_; }
+    
+private:
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight MAX_WEIGHT = std::numeric_limits<Weight>::max();
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    
+    // исходные рёбра занимают номера [0, original_edge_count_), сокращения идут за ними
+    struct HierarchyEdge {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        EdgeId first = NO_EDGE;
+        EdgeId second = NO_EDGE;
+    };
+    
+    // вспомогательное состояние, нужное только на время построения иерархии
+    class Builder;
+    
+    void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& result) const;
+    
+    size_t original_edge_count_ = 0;
+    std::vector<HierarchyEdge> edges_;
+    
+    // рёбра к более важным вершинам: исходящие для прямого поиска и входящие для обратного
+    std::vector<size_t> up_offsets_, down_offsets_;
+    std::vector<EdgeId> up_edges_, down_edges_;
+    
+    mutable SearchSpacePool<Weight> spaces_;
+};
+
+template <typename Weight>
+class ContractionHierarchy<Weight>::Builder {
+public:
+    Builder(const Graph& graph, std::vector<HierarchyEdge>& edges)
+        : edges_(edges), vertex_count_(graph.GetVertexCount())
+        , out_(vertex_count_), in_(vertex_count_)
+        , contracted_(vertex_count_, false), contracted_neighbours_(vertex_count_, 0)
+        , witness_weights_(vertex_count_, MAX_WEIGHT), witness_hops_(vertex_count_, 0) {
+        
+        std::vector<EdgeId> edge_ids;
+        edge_ids.reserve(graph.GetEdgeCount());
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            edges_.push_back({edge.from, edge.to, edge.weight});
+            if (edge.from != edge.to) {
+                edge_ids.push_back(edge_id);
+            }
+        }
+        is_used_.assign(edges_.size(), false);
+        
+        /*
+         * Из параллельных рёбер сжатию нужно только самое лёгкое (при равных весах -- с меньшим номером):
+         * в модели ALL_SPANS между двумя остановками бывают рёбра многих автобусов, и перебор пар соседей
+         * шёл бы по всем им. Остальные рёбра в иерархию не попадают, но их номера сохраняются.
+         */
+        std::sort(edge_ids.begin(), edge_ids.end(), [this](EdgeId lhs, EdgeId rhs) {
+            return std::tie(edges_[lhs].from, edges_[lhs].to, edges_[lhs].weight, lhs)
+                 < std::tie(edges_[rhs].from, edges_[rhs].to, edges_[rhs].weight, rhs);
+        });
+        for (size_t i = 0; i < edge_ids.size(); ++i) {
+            const HierarchyEdge& edge = edges_[edge_ids[i]];
+            if (i > 0 && edge.from == edges_[edge_ids[i - 1]].from && edge.to == edges_[edge_ids[i - 1]].to) {
+                continue;
+            }
+            out_[edge.from].push_back(edge_ids[i]);
+            in_[edge.to].push_back(edge_ids[i]);
+            is_used_[edge_ids[i]] = true;
+        }
+    }
+    
+    // возвращает ранг каждой вершины: чем позже она сжата, тем выше
+    std::vector<size_t> Contract() {
+        /*
+         * После сжатия вершины у каждого её соседа на единицу растёт число сжатых соседей, и его приоритет
+         * сразу обновляется в очереди; устаревшие записи очереди пропускаются. Разность рёбер у соседей
+         * меняется тоже, но её пересчёт требует поиска свидетелей для всех пар их соседей: на сети
+         * из 600 остановок построение от этого замедлялось в 17 раз. Поэтому она уточняется лениво --
+         * для вершины, оказавшейся на вершине очереди.
+         */
+        using Entry = std::pair<long long, VertexId>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+        std::vector<long long> priorities(vertex_count_);
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            priorities[vertex] = Priority(vertex);
+            queue.emplace(priorities[vertex], vertex);
+        }
+        
+        std::vector<size_t> ranks(vertex_count_);
+        std::vector<VertexId> neighbours;
+        size_t rank = 0;
+        while (!queue.empty()) {
+            const auto [queued_priority, vertex] = queue.top();
+            queue.pop();
+            if (contracted_[vertex] || queued_priority != priorities[vertex]) {
+                continue;
+            }
+            
+            if (long long priority = Priority(vertex); !queue.empty() && priority > queue.top().first) {
+                priorities[vertex] = priority;
+                queue.emplace(priority, vertex);
+                continue;
+            }
+            
+            // после сжатия вершина пропадёт из списков соседей, поэтому соседей запоминаем заранее
+            neighbours.clear();
+            for (EdgeId edge_id : in_[vertex]) {
+                neighbours.push_back(edges_[edge_id].from);
+            }
+            for (EdgeId edge_id : out_[vertex]) {
+                neighbours.push_back(edges_[edge_id].to);
+            }
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+            
+            ContractVertex(vertex, true);
+            ranks[vertex] = rank++;
+            
+            for (VertexId neighbour : neighbours) {
+                if (!contracted_[neighbour]) {
+                    ++priorities[neighbour];
+                    queue.emplace(priorities[neighbour], neighbour);
+                }
+            }
+        }
+        return ranks;
+    }
+    
+    // рёбра, вошедшие в иерархию: исходные без более тяжёлых параллельных и не вытесненные сокращения
+    inline const std::vector<bool>& GetUsedEdges() const { return is_used_; }
+    
+private:
+    // ограничения на размер поиска свидетелей: если свидетель не найден быстро, сокращение добавляется;
+    // для оценки приоритета хватает грубого поиска, настоящее сжатие ищет тщательнее
+    static constexpr size_t ESTIMATE_SETTLED_LIMIT = 50;
+    static constexpr size_t ESTIMATE_HOP_LIMIT = 2;
+    static constexpr size_t CONTRACT_SETTLED_LIMIT = 100;
+    static constexpr size_t CONTRACT_HOP_LIMIT = 5;
+    
+    // разность рёбер плюс число уже сжатых соседей, чтобы сжатие шло по графу равномерно
+    long long Priority(VertexId vertex) {
+        long long removed = 0;
+        for (EdgeId edge_id : in_[vertex]) {
+            removed += !contracted_[edges_[edge_id].from];
+        }
+        for (EdgeId edge_id : out_[vertex]) {
+            removed += !contracted_[edges_[edge_id].to];
+        }
+        const long long added = static_cast<long long>(ContractVertex(vertex, false));
+        return added - removed + contracted_neighbours_[vertex];
+    }
+    
+    // для каждой пары соседей u -> vertex -> x добавляет сокращение, если нет пути u -> x не длиннее
+    size_t ContractVertex(VertexId vertex, bool apply) {
+        size_t shortcuts = 0;
+        for (size_t in_index = 0; in_index < in_[vertex].size(); ++in_index) {
+            const EdgeId in_id = in_[vertex][in_index];
+            const VertexId source = edges_[in_id].from;
+            if (contracted_[source]) {
+                continue;
+            }
+            
+            Weight limit = ZERO_WEIGHT;
+            for (EdgeId out_id : out_[vertex]) {
+                if (!contracted_[edges_[out_id].to]) {
+                    limit = std::max(limit, edges_[in_id].weight + edges_[out_id].weight);
+                }
+            }
+            if (apply) {
+                FindWitnesses(source, vertex, limit, CONTRACT_SETTLED_LIMIT, CONTRACT_HOP_LIMIT);
+            } else {
+                FindWitnesses(source, vertex, limit, ESTIMATE_SETTLED_LIMIT, ESTIMATE_HOP_LIMIT);
+            }
+            
+            for (size_t out_index = 0; out_index < out_[vertex].size(); ++out_index) {
+                const EdgeId out_id = out_[vertex][out_index];
+                const VertexId target = edges_[out_id].to;
+                const Weight weight = edges_[in_id].weight + edges_[out_id].weight;
+                if (contracted_[target] || target == source || witness_weights_[target] <= weight) {
+                    continue;
+                }
+                
+                ++shortcuts;
+                if (apply) {
+                    // добавленное сокращение само служит свидетелем для параллельных рёбер
+                    if (witness_weights_[target] == MAX_WEIGHT) {
+                        touched_.push_back(target);
+                    }
+                    witness_weights_[target] = weight;
+                    edges_.push_back({source, target, weight, in_id, out_id});
+                    AddEdge(edges_.size() - 1);
+                }
+            }
+        }
+        
+        if (apply) {
+            // убираем сжатую вершину из списков соседей, чтобы дальнейшие поиски её не перебирали
+            contracted_[vertex] = true;
+            auto is_contracted_from = [this](EdgeId edge_id) { return contracted_[edges_[edge_id].from]; };
+            auto is_contracted_to = [this](EdgeId edge_id) { return contracted_[edges_[edge_id].to]; };
+            for (EdgeId edge_id : in_[vertex]) {
+                const VertexId neighbour = edges_[edge_id].from;
+                ++contracted_neighbours_[neighbour];
+                std::erase_if(out_[neighbour], is_contracted_to);
+            }
+            for (EdgeId edge_id : out_[vertex]) {
+                const VertexId neighbour = edges_[edge_id].to;
+                ++contracted_neighbours_[neighbour];
+                std::erase_if(in_[neighbour], is_contracted_from);
+            }
+        }
+        return shortcuts;
+    }
+    
+    /*
+     * Добавляет сокращение в списки соседей. Свидетелем всегда служит и прямое ребро source -> target,
+     * поэтому сокращение добавляется, только если оно легче: прямое ребро тогда вытесняется, и между
+     * двумя вершинами по-прежнему остаётся не больше одного ребра.
+     */
+    void AddEdge(EdgeId edge_id) {
+        const VertexId source = edges_[edge_id].from, target = edges_[edge_id].to;
+        is_used_.push_back(true);
+        
+        auto is_parallel = [this, target](EdgeId other) { return edges_[other].to == target; };
+        if (auto it = std::find_if(out_[source].begin(), out_[source].end(), is_parallel); it != out_[source].end()) {
+            is_used_[*it] = false;
+            std::replace(in_[target].begin(), in_[target].end(), *it, edge_id);
+            *it = edge_id;
+            return;
+        }
+        out_[source].push_back(edge_id);
+        in_[target].push_back(edge_id);
+    }
+    
+    // локальная Дейкстра от source в оставшемся графе без вершины excluded
+    void FindWitnesses(VertexId source, VertexId excluded, Weight limit, size_t settled_limit, size_t hop_limit) {
+        for (VertexId vertex : touched_) {
+            witness_weights_[vertex] = MAX_WEIGHT;
+        }
+        touched_.clear();
+        
+        using Entry = std::pair<Weight, VertexId>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+        witness_weights_[source] = ZERO_WEIGHT;
+        witness_hops_[source] = 0;
+        touched_.push_back(source);
+        queue.emplace(ZERO_WEIGHT, source);
+        
+        for (size_t settled = 0; !queue.empty() && settled < settled_limit; ++settled) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > witness_weights_[vertex]) {
+                continue;
+            }
+            if (weight > limit) {
+                break;
+            }
+            if (witness_hops_[vertex] == hop_limit) {
+                continue;
+            }
+            
+            for (EdgeId edge_id : out_[vertex]) {
+                const HierarchyEdge& edge = edges_[edge_id];
+                if (edge.to == excluded) {
+                    continue;
+                }
+                if (const Weight candidate = weight + edge.weight; candidate < witness_weights_[edge.to]) {
+                    if (witness_weights_[edge.to] == MAX_WEIGHT) {
+                        touched_.push_back(edge.to);
+                    }
+                    witness_weights_[edge.to] = candidate;
+                    witness_hops_[edge.to] = witness_hops_[vertex] + 1;
+                    queue.emplace(candidate, edge.to);
+                }
+            }
+        }
+    }
+    
+    std::vector<HierarchyEdge>& edges_;
+    const size_t vertex_count_;
+    
+    std::vector<std::vector<EdgeId>> out_;
+    std::vector<std::vector<EdgeId>> in_;
+    std::vector<bool> contracted_;
+    std::vector<long long> contracted_neighbours_;
+    
+    std::vector<Weight> witness_weights_;
+    std::vector<size_t> witness_hops_;
+    std::vector<VertexId> touched_;
+    
+    std::vector<bool> is_used_; // по номерам рёбер
+};
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+    : original_edge_count_(graph.GetEdgeCount()), spaces_(graph.GetVertexCount()) {
+    
+    Builder builder(graph, edges_);
+    const std::vector<size_t> ranks = builder.Contract();
+    const std::vector<bool>& is_used = builder.GetUsedEdges();
+    
+    // раскладываем рёбра, ведущие вверх по иерархии, в непрерывные списки по вершинам
+    const size_t vertex_count = graph.GetVertexCount();
+    up_offsets_.assign(vertex_count + 1, 0);
+    down_offsets_.assign(vertex_count + 1, 0);
+    for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        const HierarchyEdge& edge = edges_[edge_id];
+        if (!is_used[edge_id]) {
+            continue;
+        }
+        if (ranks[edge.from] < ranks[edge.to]) {
+            ++up_offsets_[edge.from + 1];
+        } else if (ranks[edge.from] > ranks[edge.to]) {
+            ++down_offsets_[edge.to + 1];
+        }
+    }
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        up_offsets_[vertex + 1] += up_offsets_[vertex];
+        down_offsets_[vertex + 1] += down_offsets_[vertex];
+    }
+    
+    up_edges_.resize(up_offsets_.back());
+    down_edges_.resize(down_offsets_.back());
+    std::vector<size_t> up_fill(up_offsets_.begin(), up_offsets_.end() - 1);
+    std::vector<size_t> down_fill(down_offsets_.begin(), down_offsets_.end() - 1);
+    for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        const HierarchyEdge& edge = edges_[edge_id];
+        if (!is_used[edge_id]) {
+            continue;
+        }
+        if (ranks[edge.from] < ranks[edge.to]) {
+            up_edges_[up_fill[edge.from]++] = edge_id;
+        } else if (ranks[edge.from] > ranks[edge.to]) {
+            down_edges_[down_fill[edge.to]++] = edge_id;
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchy<Weight>::RouteInfo>
+ContractionHierarchy<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = up_offsets_.size() - 1;
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex is out of graph's range");
+    }
+    
+    // [0] -- прямой поиск от from по рёбрам вверх, [1] -- обратный поиск от to по входящим рёбрам сверху
+    using Entry = std::pair<Weight, VertexId>;
+    using Queue = std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>;
+    const typename SearchSpacePool<Weight>::Lease spaces[2] = {spaces_.Acquire(), spaces_.Acquire()};
+    Queue queues[2];
+    
+    spaces[0]->Update(from, ZERO_WEIGHT, NO_EDGE);
+    spaces[1]->Update(to, ZERO_WEIGHT, NO_EDGE);
+    queues[0].emplace(ZERO_WEIGHT, from);
+    queues[1].emplace(ZERO_WEIGHT, to);
+    
+    Weight best = from == to ? ZERO_WEIGHT : MAX_WEIGHT;
+    VertexId meeting = from;
+    
+    for (int side = 0; !queues[0].empty() || !queues[1].empty(); side ^= 1) {
+        Queue& queue = queues[side];
+        if (queue.empty()) {
+            continue;
+        }
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        
+        SearchSpace<Weight>& space = *spaces[side];
+        if (weight > space.GetWeight(vertex)) {
+            continue;
+        }
+        if (weight >= best) {
+            // дальше в этом направлении путь короче найденного не получить
+            queue = Queue();
+            continue;
+        }
+        
+        if (const Weight other = spaces[side ^ 1]->GetWeight(vertex); other != MAX_WEIGHT && weight + other < best) {
+            best = weight + other;
+            meeting = vertex;
+        }
+        
+        const auto& offsets = side == 0 ? up_offsets_ : down_offsets_;
+        const auto& incident = side == 0 ? up_edges_ : down_edges_;
+        for (size_t index = offsets[vertex]; index < offsets[vertex + 1]; ++index) {
+            const EdgeId edge_id = incident[index];
+            const HierarchyEdge& edge = edges_[edge_id];
+            const VertexId next = side == 0 ? edge.to : edge.from;
+            if (const Weight candidate = weight + edge.weight; candidate < space.GetWeight(next)) {
+                space.Update(next, candidate, edge_id);
+                queue.emplace(candidate, next);
+            }
+        }
+    }
+    
+    if (best == MAX_WEIGHT) {
+        return std::nullopt;
+    }
+    
+    // собираем путь from -> meeting -> to из рёбер иерархии и раскрываем сокращения
+    std::vector<EdgeId> upward;
+    for (EdgeId edge_id = spaces[0]->GetPrevEdge(meeting); edge_id != NO_EDGE;
+         edge_id = spaces[0]->GetPrevEdge(edges_[edge_id].from)) {
+        upward.push_back(edge_id);
+    }
+    std::reverse(upward.begin(), upward.end());
+    for (EdgeId edge_id = spaces[1]->GetPrevEdge(meeting); edge_id != NO_EDGE;
+         edge_id = spaces[1]->GetPrevEdge(edges_[edge_id].to)) {
+        upward.push_back(edge_id);
+    }
+    
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id : upward) {
+        UnpackEdge(edge_id, edges);
+    }
+    
+    return RouteInfo{best, std::move(edges)};
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& result) const {
+    std::vector<EdgeId> stack{edge_id};
+    while (!stack.empty()) {
+        const HierarchyEdge& edge = edges_[stack.back()];
+        if (edge.first == NO_EDGE) {
+            result.push_back(stack.back());
+            stack.pop_back();
+        } else {
+            stack.back() = edge.second;
+            stack.push_back(edge.first);
+        }
+    }
+}
+
+}  // namespace graph
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "radix_heap.h"
+#include "router.h"
+#include "search_space.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+/*
+ * Поиск кратчайшего пути по запросу: без предрасчёта, O(E log V) на запрос.
+ * Queue -- очередь с приоритетом (BinaryHeap или RadixHeap).
+ * Если задан потенциал (допустимая и согласованная оценка снизу расстояния до цели), работает как A*.
+ */
+template <typename Weight, typename Queue = BinaryHeap<Weight>>
+class DijkstraRouter final : public RouterBase<Weight> {
+private:
+    using Graph = CsrGraph<Weight>;
+    
+public:
+    using RouteInfo = typename RouterBase<Weight>::RouteInfo;
+    using Potential = std::function<Weight(VertexId vertex, VertexId target)>;
+    
+    explicit DijkstraRouter(const Graph& graph, Potential potential = nullptr);
+    
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+    
+private:
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    
+    const Graph& graph_;
+    Potential potential_;
+    mutable SearchSpacePool<Weight> spaces_;
+};
+
+template <typename Weight, typename Queue>
+DijkstraRouter<Weight, Queue>::DijkstraRouter(const Graph& graph, Potential potential)
+    : graph_(graph), potential_(std::move(potential)), spaces_(graph.GetVertexCount()) {
+    
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight, typename Queue>
+std::optional<typename DijkstraRouter<Weight, Queue>::RouteInfo>
+DijkstraRouter<Weight, Queue>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex is out of graph's range");
+    }
+    
+    const auto space = spaces_.Acquire();
+    
+    auto priority = [this, to](Weight weight, VertexId vertex) {
+        return potential_ ? weight + potential_(vertex, to) : weight;
+    };
+    
+    Queue queue;
+    space->Update(from, ZERO_WEIGHT, NO_EDGE);
+    queue.Push(priority(ZERO_WEIGHT, from), from);
+    
+    while (!queue.Empty()) {
+        const VertexId vertex = queue.Pop().second;
+        if (space->IsSettled(vertex)) {
+            continue;
+        }
+        space->Settle(vertex);
+        if (vertex == to) {
+            break;
+        }
+        
+        for (const auto& edge : graph_.GetIncidentEdges(vertex)) {
+            const Weight candidate_weight = space->GetWeight(vertex) + edge.weight;
+            if (!space->IsSettled(edge.to) && candidate_weight < space->GetWeight(edge.to)) {
+                space->Update(edge.to, candidate_weight, graph_.GetEdgeId(edge));
+                queue.Push(priority(candidate_weight, edge.to), edge.to);
+            }
+        }
+    }
+    
+    if (!space->IsSettled(to)) {
+        return std::nullopt;
+    }
+    
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = space->GetPrevEdge(to); edge_id != NO_EDGE;
+         edge_id = space->GetPrevEdge(graph_.GetEdge(edge_id).from)) {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+    
+    return RouteInfo{space->GetWeight(to), std::move(edges)};
+}
+
+}  // namespace graph
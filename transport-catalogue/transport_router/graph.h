@@ -2,7 +2,10 @@
 
 #include "ranges.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <span>
+#include <stdexcept>
 #include <vector>
 
 namespace graph {
@@ -43,6 +46,48 @@ private:
     std::vector<IncidenceList> incidence_lists_;
 };
 
+/*
+ * Неизменяемый граф в формате CSR (compressed sparse row): рёбра отсортированы по начальной вершине
+ * и лежат в одном массиве, а рёбра вершины v занимают отрезок [offsets_[v], offsets_[v + 1]).
+ * Обход исходящих рёбер идёт подряд по памяти, без отдельного списка на каждую вершину.
+ * Номер ребра -- его позиция в этом массиве, он не совпадает с номером в исходном графе.
+ * Массивы могут принадлежать графу или лежать во внешней памяти (например, в отображённом файле снимка).
+ */
+template <typename Weight>
+class CsrGraph {
+private:
+    using IncidentEdgesRange = ranges::Range<const Edge<Weight>*>;
+    
+public:
+    CsrGraph() = default;
+    explicit CsrGraph(const DirectedWeightedGraph<Weight>& graph);
+    // граф поверх чужих массивов без копирования; память должна жить дольше графа
+    CsrGraph(std::span<const size_t> offsets, std::span<const Edge<Weight>> edges);
+    
+    CsrGraph(const CsrGraph&) = delete;
+    CsrGraph(CsrGraph&&) = default;
+    
+    CsrGraph& operator=(const CsrGraph&) = delete;
+    CsrGraph& operator=(CsrGraph&&) = default;
+    
+    inline size_t GetVertexCount() const { return offsets_.size() - 1; }
+    inline size_t GetEdgeCount() const { return edges_.size(); }
+    inline const Edge<Weight>& GetEdge(EdgeId edge_id) const { return edges_[edge_id]; }
+    inline EdgeId GetEdgeId(const Edge<Weight>& edge) const { return &edge - edges_.data(); }
+    IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
+    
+    inline std::span<const size_t> GetOffsets() const { return offsets_; }
+    inline std::span<const Edge<Weight>> GetEdges() const { return edges_; }
+    
+private:
+    // при перемещении векторы отдают свой буфер целиком, поэтому представления ниже остаются верными
+    std::vector<size_t> offsets_storage_{0};
+    std::vector<Edge<Weight>> edges_storage_;
+    
+    std::span<const size_t> offsets_{offsets_storage_};
+    std::span<const Edge<Weight>> edges_{edges_storage_};
+};
+
 template <typename Weight>
 DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
     : incidence_lists_(vertex_count) {
@@ -77,4 +122,41 @@ DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
     return ranges::AsRange(incidence_lists_.at(vertex));
 }
 
+template <typename Weight>
+CsrGraph<Weight>::CsrGraph(const DirectedWeightedGraph<Weight>& graph)
+    : offsets_storage_(graph.GetVertexCount() + 1, 0) {
+    
+    edges_storage_.reserve(graph.GetEdgeCount());
+    for (VertexId vertex = 0; vertex < graph.GetVertexCount(); ++vertex) {
+        for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+            edges_storage_.push_back(graph.GetEdge(edge_id));
+        }
+        offsets_storage_[vertex + 1] = edges_storage_.size();
+    }
+    offsets_ = offsets_storage_;
+    edges_ = edges_storage_;
+}
+
+template <typename Weight>
+CsrGraph<Weight>::CsrGraph(std::span<const size_t> offsets, std::span<const Edge<Weight>> edges)
+    : offsets_(offsets), edges_(edges) {
+    
+    if (offsets_.empty() || offsets_.front() != 0 || offsets_.back() != edges_.size()
+        || !std::is_sorted(offsets_.begin(), offsets_.end())) {
+        throw std::invalid_argument("Malformed CSR graph offsets");
+    }
+    for (VertexId vertex = 0; vertex < GetVertexCount(); ++vertex) {
+        for (const Edge<Weight>& edge : GetIncidentEdges(vertex)) {
+            if (edge.from != vertex || edge.to >= GetVertexCount()) {
+                throw std::invalid_argument("Malformed CSR graph edge");
+            }
+        }
+    }
+}
+
+template <typename Weight>
+typename CsrGraph<Weight>::IncidentEdgesRange CsrGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
+    return IncidentEdgesRange(edges_.data() + offsets_[vertex], edges_.data() + offsets_[vertex + 1]);
+}
+
 }  // namespace graph
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <functional>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace router {
+
+/*
+ * Кэш ограниченного размера: при переполнении вытесняется значение, к которому дольше всех не обращались.
+ * Все операции берут один мьютекс, поэтому значение лучше делать дешёвым для копирования (например,
+ * shared_ptr на неизменяемые данные): Find копирует его под блокировкой.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity) : capacity_(capacity) {}
+    
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+    
+    // найденное значение становится самым свежим
+    std::optional<Value> Find(const Key& key) {
+        std::lock_guard guard(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            return std::nullopt;
+        }
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->second;
+    }
+    
+    // значение для уже известного ключа заменяется
+    void Insert(const Key& key, Value value) {
+        if (capacity_ == 0) {
+            return;
+        }
+        std::lock_guard guard(mutex_);
+        if (auto it = index_.find(key); it != index_.end()) {
+            it->second->second = std::move(value);
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return;
+        }
+        
+        if (entries_.size() == capacity_) {
+            // узел вытесняемого значения переиспользуется для нового
+            index_.erase(entries_.back().first);
+            entries_.splice(entries_.begin(), entries_, std::prev(entries_.end()));
+            entries_.front() = {key, std::move(value)};
+        } else {
+            entries_.emplace_front(key, std::move(value));
+        }
+        index_.emplace(key, entries_.begin());
+    }
+    
+    size_t Size() const {
+        std::lock_guard guard(mutex_);
+        return entries_.size();
+    }
+    inline size_t Capacity() const { return capacity_; }
+    
+private:
+    using Entry = std::pair<Key, Value>;
+    
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_; // от самых свежих к самым старым
+    std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index_;
+};
+
+} // namespace router
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// обычная двоичная куча поверх std::priority_queue: извлекает элемент с наименьшим ключом
+template <typename Weight>
+class BinaryHeap {
+public:
+    inline bool Empty() const { return heap_.empty(); }
+    inline void Push(Weight key, VertexId vertex) { heap_.emplace(key, vertex); }
+    
+    std::pair<Weight, VertexId> Pop() {
+        std::pair<Weight, VertexId> top = heap_.top();
+        heap_.pop();
+        return top;
+    }
+    
+private:
+    using Entry = std::pair<Weight, VertexId>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap_;
+};
+
+/*
+ * Монотонная радикс-куча: ключи извлекаются в неубывающем порядке, поэтому каждый элемент
+ * перекладывается между корзинами не более 64 раз, а Pop() обходится без сравнений по куче.
+ * Неотрицательные double при побитовой интерпретации как uint64_t сохраняют порядок,
+ * поэтому куча работает и с вещественными весами.
+ */
+template <typename Weight>
+class RadixHeap {
+    static_assert(std::is_arithmetic_v<Weight> && sizeof(Weight) <= sizeof(uint64_t));
+    
+public:
+    inline bool Empty() const { return size_ == 0; }
+    
+    // ключ не может быть меньше последнего извлечённого: в Дейкстре с неотрицательными весами это так и есть.
+    // Меньший ключ всё же поднимается до него, чтобы не попасть в пройденную корзину, но порядок при этом
+    // искажается, поэтому с немонотонной очередью (например, A* с несогласованным потенциалом) куча не работает
+    void Push(Weight key, VertexId vertex) {
+        uint64_t raw = std::max(ToRaw(key), last_);
+        buckets_[BucketOf(raw)].emplace_back(raw, vertex);
+        ++size_;
+    }
+    
+    std::pair<Weight, VertexId> Pop() {
+        if (buckets_[0].empty()) {
+            Redistribute();
+        }
+        
+        VertexId vertex = buckets_[0].back().second;
+        buckets_[0].pop_back();
+        --size_;
+        return {FromRaw(last_), vertex};
+    }
+    
+private:
+    using Entry = std::pair<uint64_t, VertexId>;
+    
+    // находим первую непустую корзину, берём её минимум за новую точку отсчёта и раскладываем заново
+    void Redistribute() {
+        size_t index = 1;
+        while (buckets_[index].empty()) {
+            ++index;
+        }
+        
+        std::vector<Entry> bucket = std::move(buckets_[index]);
+        buckets_[index].clear();
+        
+        last_ = bucket.front().first;
+        for (const Entry& entry : bucket) {
+            last_ = std::min(last_, entry.first);
+        }
+        for (const Entry& entry : bucket) {
+            buckets_[BucketOf(entry.first)].push_back(entry);
+        }
+    }
+    
+    inline size_t BucketOf(uint64_t raw) const {
+        return raw == last_ ? 0 : std::numeric_limits<uint64_t>::digits - std::countl_zero(raw ^ last_);
+    }
+    
+    static uint64_t ToRaw(Weight key) {
+        if constexpr (std::is_same_v<Weight, double>) {
+            return std::bit_cast<uint64_t>(key);
+        } else {
+            return static_cast<uint64_t>(key);
+        }
+    }
+    
+    static Weight FromRaw(uint64_t raw) {
+        if constexpr (std::is_same_v<Weight, double>) {
+            return std::bit_cast<double>(raw);
+        } else {
+            return static_cast<Weight>(raw);
+        }
+    }
+    
+    std::array<std::vector<Entry>, std::numeric_limits<uint64_t>::digits + 1> buckets_;
+    uint64_t last_ = 0;
+    size_t size_ = 0;
+};
+
+}  // namespace graph
@@ -3,108 +3,195 @@
 #include "graph.h"
 
 #include <algorithm>
+#include <barrier>
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
+#include <span>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
+// общий интерфейс маршрутизаторов, чтобы TransportRouter мог выбирать алгоритм поиска пути
 template <typename Weight>
-class Router {
-private:
-    using Graph = DirectedWeightedGraph<Weight>;
-    
+class RouterBase {
 public:
-    explicit Router(const Graph& graph);
-    
     struct RouteInfo {
         Weight weight;
         std::vector<EdgeId> edges;
     };
     
-    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+    virtual ~RouterBase() = default;
     
+    virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+};
+
+// предрасчёт всех пар кратчайших путей алгоритмом Флойда-Уоршелла: O(V^3) времени и O(V^2) памяти
+template <typename Weight>
+class Router final : public RouterBase<Weight> {
 private:
-    struct RouteInternalData {
-        Weight weight;
-        std::optional<EdgeId> prev_edge;
+    using Graph = CsrGraph<Weight>;
+    
+public:
+    using RouteInfo = typename RouterBase<Weight>::RouteInfo;
+    
+    /*
+     * Таблица всех пар хранится двумя плоскими массивами V x V по строкам: веса путей и последние рёбра.
+     * Недостижимость и отсутствие ребра кодируются значениями-маркерами, а не std::optional: ячейка
+     * занимает 12 байт вместо 32, а внутренний цикл релаксации становится пригодным для векторизации.
+     */
+    using PrevEdge = uint32_t;
+    struct RoutesTable {
+        std::span<const Weight> weights;
+        std::span<const PrevEdge> prev_edges;
     };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+    
+    explicit Router(const Graph& graph, size_t thread_count = 1);
+    // маршрутизатор поверх готовой таблицы без копирования; память должна жить дольше маршрутизатора
+    Router(const Graph& graph, RoutesTable table);
+    
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+    
+    inline RoutesTable GetRoutesTable() const { return table_; }
+    
+private:
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::has_infinity
+                                          ? std::numeric_limits<Weight>::infinity()
+                                          : std::numeric_limits<Weight>::max();
+    static constexpr PrevEdge NO_EDGE = std::numeric_limits<PrevEdge>::max();
+    
+    inline size_t Cell(VertexId from, VertexId to) const { return from * vertex_count_ + to; }
     
     void InitializeRoutesInternalData(const Graph& graph) {
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
-            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
-                const auto& edge = graph.GetEdge(edge_id);
+        if (graph.GetEdgeCount() >= NO_EDGE) {
+            throw std::length_error("Too many edges for routes table");
+        }
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            weights_[Cell(vertex, vertex)] = ZERO_WEIGHT;
+            for (const auto& edge : graph.GetIncidentEdges(vertex)) {
                 if (edge.weight < ZERO_WEIGHT) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                const size_t cell = Cell(vertex, edge.to);
+                if (weights_[cell] == UNREACHABLE || weights_[cell] > edge.weight) {
+                    weights_[cell] = edge.weight;
+                    prev_edges_[cell] = static_cast<PrevEdge>(graph.GetEdgeId(edge));
                 }
             }
         }
     }
     
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                    const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
-        }
-    }
-    
-    void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+    // обрабатывает строки [from_begin, from_end) таблицы; разные строки можно обрабатывать параллельно
+    void RelaxRoutesInternalDataThroughVertex(VertexId from_begin, VertexId from_end, VertexId vertex_through) {
+        const Weight* through_weights = &weights_[Cell(vertex_through, 0)];
+        const PrevEdge* through_prev_edges = &prev_edges_[Cell(vertex_through, 0)];
+        
+        for (VertexId vertex_from = from_begin; vertex_from < from_end; ++vertex_from) {
+            const Weight weight_from = weights_[Cell(vertex_from, vertex_through)];
+            if (weight_from == UNREACHABLE) {
+                continue;
+            }
+            const PrevEdge prev_edge_from = prev_edges_[Cell(vertex_from, vertex_through)];
+            Weight* from_weights = &weights_[Cell(vertex_from, 0)];
+            PrevEdge* from_prev_edges = &prev_edges_[Cell(vertex_from, 0)];
+            
+            for (VertexId vertex_to = 0; vertex_to < vertex_count_; ++vertex_to) {
+                // бесконечность в сумме остаётся бесконечностью, так что проверка нужна только для целых весов
+                if constexpr (!std::numeric_limits<Weight>::has_infinity) {
+                    if (through_weights[vertex_to] == UNREACHABLE) {
+                        continue;
                     }
                 }
+                const Weight candidate_weight = weight_from + through_weights[vertex_to];
+                if (candidate_weight < from_weights[vertex_to]) {
+                    from_weights[vertex_to] = candidate_weight;
+                    from_prev_edges[vertex_to] = through_prev_edges[vertex_to] != NO_EDGE ? through_prev_edges[vertex_to]
+                                                                                          : prev_edge_from;
+                }
             }
         }
     }
     
-    static constexpr Weight ZERO_WEIGHT{};
     const Graph& graph_;
-    RoutesInternalData routes_internal_data_;
+    const size_t vertex_count_;
+    std::vector<Weight> weights_;
+    std::vector<PrevEdge> prev_edges_;
+    RoutesTable table_{weights_, prev_edges_};
 };
 
 template <typename Weight>
-Router<Weight>::Router(const Graph& graph)
-    : graph_(graph), routes_internal_data_(graph.GetVertexCount(),
-                                           std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount())) {
+Router<Weight>::Router(const Graph& graph, size_t thread_count)
+    : graph_(graph), vertex_count_(graph.GetVertexCount())
+    , weights_(vertex_count_ * vertex_count_, UNREACHABLE), prev_edges_(vertex_count_ * vertex_count_, NO_EDGE) {
     
     InitializeRoutesInternalData(graph);
     
-    const size_t vertex_count = graph.GetVertexCount();
-    for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+    thread_count = std::clamp<size_t>(thread_count, 1, std::max<size_t>(vertex_count_, 1));
+    if (thread_count == 1) {
+        for (VertexId vertex_through = 0; vertex_through < vertex_count_; ++vertex_through) {
+            RelaxRoutesInternalDataThroughVertex(0, vertex_count_, vertex_through);
+        }
+        return;
+    }
+    
+    /*
+     * Пока идёт релаксация через vertex_through, его строка и столбец не меняются (путь до самого себя
+     * нулевой и улучшить его нельзя), поэтому строки делятся между потоками без блокировок, а результат
+     * совпадает с последовательным до бита. Между итерациями потоки дожидаются друг друга на барьере.
+     */
+    std::barrier sync(static_cast<std::ptrdiff_t>(thread_count));
+    auto relax_rows = [this, &sync, thread_count](size_t index) {
+        const VertexId from_begin = vertex_count_ * index / thread_count;
+        const VertexId from_end = vertex_count_ * (index + 1) / thread_count;
+        for (VertexId vertex_through = 0; vertex_through < vertex_count_; ++vertex_through) {
+            RelaxRoutesInternalDataThroughVertex(from_begin, from_end, vertex_through);
+            sync.arrive_and_wait();
+        }
+    };
+    
+    std::vector<std::jthread> workers;
+    workers.reserve(thread_count - 1);
+    for (size_t index = 1; index < thread_count; ++index) {
+        workers.emplace_back(relax_rows, index);
+    }
+    relax_rows(0);
+}
+
+template <typename Weight>
+Router<Weight>::Router(const Graph& graph, RoutesTable table)
+    : graph_(graph), vertex_count_(graph.GetVertexCount()), table_(table) {
+    
+    if (table_.weights.size() != vertex_count_ * vertex_count_
+        || table_.prev_edges.size() != vertex_count_ * vertex_count_) {
+        throw std::invalid_argument("Routes table doesn't match the graph");
     }
 }
 
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                              VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-    if (!route_internal_data) {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex is out of graph's range");
+    }
+    const Weight weight = table_.weights[Cell(from, to)];
+    if (weight == UNREACHABLE) {
         return std::nullopt;
     }
-    const Weight weight = route_internal_data->weight;
     std::vector<EdgeId> edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-         edge_id; edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge) {
-             edges.push_back(*edge_id);
+    for (PrevEdge edge_id = table_.prev_edges[Cell(from, to)];
+         edge_id != NO_EDGE; edge_id = table_.prev_edges[Cell(from, graph_.GetEdge(edge_id).from)]) {
+             // таблица могла прийти извне, поэтому не доверяем ей слепо
+             if (edge_id >= graph_.GetEdgeCount() || edges.size() >= vertex_count_) {
+                 throw std::runtime_error("Routes table is corrupted");
+             }
+             edges.push_back(edge_id);
     }
     std::reverse(edges.begin(), edges.end());
     
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "graph.h"
+
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+/*
+ * Разметка вершин для поиска по запросу: найденные веса, последние рёбра путей и просмотренные вершины.
+ * Массивы на V вершин выделяются один раз, а Reset возвращает в исходное состояние только те вершины,
+ * которых касался последний поиск, -- запрос, просмотревший малую часть графа, не платит за весь граф.
+ */
+template <typename Weight>
+class SearchSpace {
+public:
+    static constexpr Weight MAX_WEIGHT = std::numeric_limits<Weight>::max();
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    
+    explicit SearchSpace(size_t vertex_count)
+        : weights_(vertex_count, MAX_WEIGHT), prev_edges_(vertex_count, NO_EDGE), settled_(vertex_count, false) {}
+    
+    inline Weight GetWeight(VertexId vertex) const { return weights_[vertex]; }
+    inline EdgeId GetPrevEdge(VertexId vertex) const { return prev_edges_[vertex]; }
+    inline bool IsSettled(VertexId vertex) const { return settled_[vertex]; }
+    
+    // вершина до первого Update не считается задетой, поэтому Settle допустим только после него
+    void Update(VertexId vertex, Weight weight, EdgeId prev_edge) {
+        if (weights_[vertex] == MAX_WEIGHT) {
+            touched_.push_back(vertex);
+        }
+        weights_[vertex] = weight;
+        prev_edges_[vertex] = prev_edge;
+    }
+    inline void Settle(VertexId vertex) { settled_[vertex] = true; }
+    
+    void Reset() {
+        for (VertexId vertex : touched_) {
+            weights_[vertex] = MAX_WEIGHT;
+            prev_edges_[vertex] = NO_EDGE;
+            settled_[vertex] = false;
+        }
+        touched_.clear();
+    }
+    
+private:
+    std::vector<Weight> weights_;
+    std::vector<EdgeId> prev_edges_;
+    std::vector<bool> settled_;
+    std::vector<VertexId> touched_;
+};
+
+/*
+ * Запас разметок для маршрутизатора, которым пользуются несколько потоков сразу: каждый запрос
+ * берёт свободную разметку, а по окончании запроса она очищается и возвращается в запас.
+ * Разметок создаётся столько, сколько запросов шло одновременно; мьютекс берётся только на выдачу и возврат.
+ */
+template <typename Weight>
+class SearchSpacePool {
+private:
+    struct Releaser {
+        SearchSpacePool* pool;
+        
+        void operator()(SearchSpace<Weight>* space) const {
+            space->Reset();
+            std::lock_guard guard(pool->mutex_);
+            pool->free_.emplace_back(space);
+        }
+    };
+    
+public:
+    using Lease = std::unique_ptr<SearchSpace<Weight>, Releaser>;
+    
+    explicit SearchSpacePool(size_t vertex_count) : vertex_count_(vertex_count) {}
+    
+    SearchSpacePool(const SearchSpacePool&) = delete;
+    SearchSpacePool& operator=(const SearchSpacePool&) = delete;
+    
+    // разметка должна вернуться в запас раньше, чем запас будет уничтожен
+    Lease Acquire() {
+        {
+            std::lock_guard guard(mutex_);
+            if (!free_.empty()) {
+                Lease lease(free_.back().release(), Releaser{this});
+                free_.pop_back();
+                return lease;
+            }
+        }
+        return Lease(new SearchSpace<Weight>(vertex_count_), Releaser{this});
+    }
+    
+private:
+    const size_t vertex_count_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<SearchSpace<Weight>>> free_;
+};
+
+}  // namespace graph
@@ -1,72 +1,388 @@
 #include "transport_router.h"
 
+#include <algorithm>
+#include <deque>
+#include <numeric>
+#include <tuple>
+#include <utility>
+
 using namespace catalogue;
+using namespace std::literals;
 #include <iostream>
 namespace router {
 
-void TransportRouter::InitGraphWaitEdges() {
-    stop_to_vertices_.reserve(catalogue_.GetStopsData().size());
+TransportRouter::TransportRouter(RoutingSettings&& settings, const TransportCatalogue& catalogue)
+    : settings_(std::move(settings)), catalogue_(catalogue) {
+    
+    SetState(MakeState(MakeGraph(), catalogue_.GetVersion()));
+}
+
+TransportRouter::TransportRouter(RoutingSettings&& settings, const TransportCatalogue& catalogue,
+                                 graph::CsrGraph<Weight>&& graph, std::vector<EdgeInfo>&& edge_infos,
+                                 std::optional<graph::Router<Weight>::RoutesTable> routes_table)
+    : settings_(std::move(settings)), catalogue_(catalogue) {
+    
+    auto state = std::make_shared<State>();
+    state->version = catalogue_.GetVersion();
+    state->stop_count = catalogue_.GetStopsData().size();
+    state->graph = std::move(graph);
+    
+    if (state->graph.GetVertexCount() != CountGraphVertices()
+        || edge_infos.size() != state->graph.GetEdgeCount()) {
+        throw std::invalid_argument("Routing graph doesn't match the catalogue");
+    }
+    for (const EdgeInfo& info : edge_infos) {
+        const bool is_valid = info.kind == EdgeKind::WAIT ? info.index < catalogue_.GetStopsData().size()
+                            : info.kind == EdgeKind::BUS && info.index < catalogue_.GetBusesData().size();
+        if (!is_valid) {
+            throw std::invalid_argument("Routing graph edge doesn't match the catalogue");
+        }
+    }
+    state->edge_infos = std::move(edge_infos);
+    
+    if (routes_table && settings_.router_type == RouterType::FLOYD_WARSHALL) {
+        state->router = std::make_unique<graph::Router<Weight>>(state->graph, *routes_table);
+    } else {
+        state->router = MakeRouter(state->graph);
+    }
+    state->route_cache = MakeRouteCache();
+    SetState(std::move(state));
+}
+
+TransportRouter::TransportRouter(const TransportRouter& previous, const TransportCatalogue& catalogue)
+    : settings_(previous.settings_), catalogue_(catalogue) {
+    
+    // у копии справочника те же номера остановок и автобусов, поэтому рёбра и элементы ответов переназначать не нужно:
+    // достаточно применить изменения после версии прежнего состояния. Граф, поиск и кэш у нового маршрутизатора свои
+    SetState(MakePatchedState(*previous.GetState()));
+}
+
+void TransportRouter::ApplyChanges() {
+    const std::shared_ptr<const State> current = GetState();
+    if (current->version == catalogue_.GetVersion()) {
+        return;
+    }
+    // запросы до этого момента отвечаются по прежнему состоянию, а начатые продолжают держать его сами
+    SetState(MakePatchedState(*current));
+}
+
+std::shared_ptr<const TransportRouter::State> TransportRouter::MakePatchedState(const State& previous) const {
+    // номера вершин цепочек зависят от длин всех предыдущих маршрутов, а строятся цепочки за линейное время:
+    // переносить рёбра из прежнего графа незачем
+    if (settings_.graph_model == GraphModel::RIDE_CHAINS) {
+        return MakeState(MakeGraph(), catalogue_.GetVersion());
+    }
+    
+    // автобусы, рёбра которых надо построить заново; изменения остановок касаются только рёбер ожидания
+    const std::deque<Bus>& buses = catalogue_.GetBusesData();
+    std::vector<bool> is_changed(buses.size(), false);
+    for (const Change& change : catalogue_.GetChanges(previous.version)) {
+        switch (change.type) {
+            case ChangeType::DISTANCE_CHANGED:
+                // перегон в любую сторону проходят только автобусы, идущие через его начало
+                for (BusId bus : catalogue_.GetStopsData()[change.id].passing_buses) {
+                    is_changed[bus] = true;
+                }
+                break;
+            case ChangeType::BUS_ADDED:
+            case ChangeType::BUS_CHANGED:
+            case ChangeType::BUS_REMOVED:
+                is_changed[change.id] = true;
+                break;
+            default:
+                break;
+        }
+    }
+    
+    // рёбра прежнего графа по автобусам; порядок CSR у рёбер одного автобуса совпадает с порядком построения
+    std::vector<size_t> bus_edges_begin(buses.size() + 1, 0);
+    for (const EdgeInfo& info : previous.edge_infos) {
+        if (info.kind == EdgeKind::BUS) {
+            ++bus_edges_begin[info.index + 1];
+        }
+    }
+    std::partial_sum(bus_edges_begin.begin(), bus_edges_begin.end(), bus_edges_begin.begin());
+    
+    std::vector<graph::EdgeId> bus_edges(bus_edges_begin.back());
+    std::vector<size_t> bus_edges_end(bus_edges_begin.begin(), bus_edges_begin.end() - 1);
+    for (graph::EdgeId edge_id = 0; edge_id < previous.edge_infos.size(); ++edge_id) {
+        if (const EdgeInfo& info = previous.edge_infos[edge_id]; info.kind == EdgeKind::BUS) {
+            bus_edges[bus_edges_end[info.index]++] = edge_id;
+        }
+    }
+    
+    // рёбра собираются в том же порядке, что и при построении с нуля, поэтому и граф получается тем же
+    GraphBuilder builder(CountGraphVertices());
+    AddGraphWaitEdges(builder);
+    for (const Bus& bus : buses) {
+        if (is_changed[bus.id]) {
+            AddGraphBusEdges(builder, bus);
+            continue;
+        }
+        for (size_t i = bus_edges_begin[bus.id]; i < bus_edges_begin[bus.id + 1]; ++i) {
+            builder.AddEdge(previous.graph.GetEdge(bus_edges[i]), previous.edge_infos[bus_edges[i]]);
+        }
+    }
+    
+    return MakeState(std::move(builder), catalogue_.GetVersion());
+}
+
+size_t TransportRouter::CountGraphVertices() const {
+    size_t count = catalogue_.GetStopsData().size() * 2;
+    if (settings_.graph_model == GraphModel::RIDE_CHAINS) {
+        for (const Bus& bus : catalogue_.GetBusesData()) {
+            count += bus.route.size();
+        }
+    }
+    return count;
+}
+
+TransportRouter::GraphBuilder TransportRouter::MakeGraph() const {
+    // вершины графа это остановки, рёбра – время ожидания на остановке или движения в автобусе
+    GraphBuilder builder(CountGraphVertices());
+    AddGraphWaitEdges(builder);
+    if (settings_.graph_model == GraphModel::RIDE_CHAINS) {
+        AddGraphRideEdges(builder);
+    } else {
+        for (const Bus& bus : catalogue_.GetBusesData()) {
+            AddGraphBusEdges(builder, bus);
+        }
+    }
+    return builder;
+}
+
+void TransportRouter::AddGraphWaitEdges(GraphBuilder& builder) const {
     Weight wait_time = static_cast<Weight>(settings_.wait_time);
     
-    for (graph::VertexId index = 0; const Stop& stop : catalogue_.GetStopsData()) {
-        graph::Edge<Weight> edge{index, index + 1, wait_time};
-        
-        graph_.AddEdge(edge);
-        
-        // добавим данные во вспомогательные объекты
-        stop_to_vertices_.emplace(stop.name, StopVertices{index, index + 1});
-        edge_to_response_.emplace(edge, WaitResponse(stop.name, wait_time));
-        
-        index += 2;
+    for (const Stop& stop : catalogue_.GetStopsData()) {
+        // вершины удалённой остановки остаются, чтобы не сдвигать номера остальных, но ни с чем не связаны
+        if (catalogue_.IsRemoved(&stop)) {
+            continue;
+        }
+        const StopVertices vertices = GetStopVertices(stop.id);
+        builder.AddEdge({vertices.begin, vertices.end, wait_time}, {EdgeKind::WAIT, stop.id, 0});
     }
 }
 
-void TransportRouter::InitGraphBusEdges() {
-    for (const catalogue::Bus& bus : catalogue_.GetBusesData()) {
-        /*
-         * Если автобус проезжает между некоторыми остановками несколько раз, 
-         * то храним наименьшее время пути на этом отрезке.
-         */
-        struct Record { double time; int span; };
-        std::unordered_map<std::pair<const Stop*, const Stop*>, Record, TransportCatalogue::StopPtrsHasher> span_to_time;
-        
-        // оценим все возможные отрезки на маршруте автобуса
-        for (auto from = bus.route.begin(); from != bus.route.end() - 1; ++from) {
-            Weight travel_time = 0.0;
+void TransportRouter::AddGraphBusEdges(GraphBuilder& builder, const Bus& bus) const {
+    struct Record {
+        StopId from, to;
+        double time;
+        int span;
+    };
+    const size_t stop_count = bus.route.size();
+    std::vector<Record> records;
+    records.reserve(stop_count * (stop_count - std::min<size_t>(stop_count, 1)) / 2);
+    
+    // оценим все возможные отрезки на маршруте автобуса; длина отрезка -- разность расстояний от начала маршрута
+    const std::vector<int>& distances = catalogue_.GetRouteDistances(&bus);
+    for (size_t from = 0; from < stop_count; ++from) {
+        for (size_t to = from + 1; to < stop_count; ++to) {
+            const Weight travel_time = (distances[to] - distances[from]) / settings_.velocity;
+            records.push_back({bus.route[from]->id, bus.route[to]->id, travel_time, static_cast<int>(to - from)});
+        }
+    }
+    
+    /*
+     * Если автобус проезжает между некоторыми остановками несколько раз, 
+     * то храним наименьшее время пути на этом отрезке; при равном времени -- первый по маршруту.
+     */
+    std::stable_sort(records.begin(), records.end(), [](const Record& lhs, const Record& rhs) {
+        return std::tie(lhs.from, lhs.to, lhs.time) < std::tie(rhs.from, rhs.to, rhs.time);
+    });
+    records.erase(std::unique(records.begin(), records.end(), [](const Record& lhs, const Record& rhs) {
+        return lhs.from == rhs.from && lhs.to == rhs.to;
+    }), records.end());
+    
+    for (const Record& record : records) {
+        graph::Edge<Weight> edge{GetStopVertices(record.from).end, GetStopVertices(record.to).begin, record.time};
+        builder.AddEdge(edge, {EdgeKind::BUS, bus.id, record.span});
+    }
+}
+
+void TransportRouter::AddGraphRideEdges(GraphBuilder& builder) const {
+    graph::VertexId ride_vertex = static_cast<graph::VertexId>(catalogue_.GetStopsData().size() * 2);
+    for (const Bus& bus : catalogue_.GetBusesData()) {
+        const std::vector<int>& distances = catalogue_.GetRouteDistances(&bus);
+        // вершина цепочки на позиции i -- это ride_vertex + i; с последней остановки не садятся, на первой не выходят
+        for (size_t i = 0; i + 1 < bus.route.size(); ++i, ++ride_vertex) {
+            const StopId from = bus.route[i]->id, to = bus.route[i + 1]->id;
+            const Weight time = (distances[i + 1] - distances[i]) / settings_.velocity;
             
-            for (auto current = from, to = from + 1; to != bus.route.end(); ++current, ++to) {
-                travel_time += catalogue_.GetDistanceBetweenStops(*current, *to) / settings_.velocity;
-                
-                std::pair<const Stop*, const Stop*> key{*from, *to};
-                Record value{travel_time, static_cast<int>(std::distance(from, to))};
-                if (auto it = span_to_time.find(key); it == span_to_time.end()) {
-                    span_to_time[key] = value;
-                } else if (travel_time < it->second.time) {
-                    it->second = value;
-                }
+            builder.AddEdge({GetStopVertices(from).end, ride_vertex, 0.0}, {EdgeKind::BUS, bus.id, 0});
+            builder.AddEdge({ride_vertex, ride_vertex + 1, time}, {EdgeKind::BUS, bus.id, 1});
+            builder.AddEdge({ride_vertex + 1, GetStopVertices(to).begin, 0.0}, {EdgeKind::BUS, bus.id, 0});
+        }
+        // у последней позиции своя вершина, хоть с неё и не садятся
+        if (!bus.route.empty()) {
+            ++ride_vertex;
+        }
+    }
+}
+
+std::shared_ptr<const TransportRouter::State> TransportRouter::MakeState(GraphBuilder&& builder, size_t version) const {
+    auto state = std::make_shared<State>();
+    state->version = version;
+    state->stop_count = catalogue_.GetStopsData().size();
+    
+    // после заполнения граф больше не меняется: переводим его в компактный вид
+    state->graph = graph::CsrGraph<Weight>(builder.graph);
+    
+    // в CSR рёбра упорядочены по начальной вершине, а у одной вершины идут в порядке добавления
+    state->edge_infos.reserve(builder.infos.size());
+    for (graph::VertexId vertex = 0; vertex < builder.graph.GetVertexCount(); ++vertex) {
+        for (const graph::EdgeId edge_id : builder.graph.GetIncidentEdges(vertex)) {
+            state->edge_infos.push_back(builder.infos[edge_id]);
+        }
+    }
+    
+    state->router = MakeRouter(state->graph);
+    state->route_cache = MakeRouteCache();
+    return state;
+}
+
+std::shared_ptr<const TransportRouter::State> TransportRouter::GetState() const {
+    std::lock_guard guard(state_mutex_);
+    return state_;
+}
+
+void TransportRouter::SetState(std::shared_ptr<const State>&& state) {
+    std::shared_ptr<const State> previous;
+    {
+        std::lock_guard guard(state_mutex_);
+        previous = std::exchange(state_, std::move(state));
+    }
+    // прежнее состояние освобождается вне блокировки, если его уже не держит ни один запрос
+}
+
+std::unique_ptr<graph::RouterBase<TransportRouter::Weight>>
+TransportRouter::MakeRouter(const graph::CsrGraph<Weight>& graph) const {
+    switch (settings_.router_type) {
+        case RouterType::FLOYD_WARSHALL:
+            return std::make_unique<graph::Router<Weight>>(graph, settings_.thread_count);
+        case RouterType::DIJKSTRA:
+            return std::make_unique<graph::DijkstraRouter<Weight>>(graph);
+        case RouterType::RADIX_DIJKSTRA:
+            return std::make_unique<graph::DijkstraRouter<Weight, graph::RadixHeap<Weight>>>(graph);
+        case RouterType::A_STAR:
+            return std::make_unique<graph::DijkstraRouter<Weight>>(graph, MakeGeoPotential());
+        case RouterType::CONTRACTION_HIERARCHY:
+            return std::make_unique<graph::ContractionHierarchy<Weight>>(graph);
+    }
+    return nullptr;
+}
+
+std::unique_ptr<TransportRouter::RouteCache> TransportRouter::MakeRouteCache() const {
+    if (settings_.cache_capacity == 0) {
+        return nullptr;
+    }
+    return std::make_unique<RouteCache>(settings_.cache_capacity);
+}
+
+graph::DijkstraRouter<TransportRouter::Weight>::Potential TransportRouter::MakeGeoPotential() const {
+    /*
+     * Дорожное расстояние может оказаться короче расстояния по прямой, поэтому оценку по прямой домножаем
+     * на наименьшее по всем перегонам отношение "дорога / прямая": тогда по неравенству треугольника она
+     * не превосходит длину любого пути, и A* остаётся точным. Небольшой запас покрывает ошибки округления.
+     */
+    // копия точек: состояние маршрутизатора не должно зависеть от последующих изменений справочника
+    geo::Points points = catalogue_.GetStopPoints();
+    double ratio = 1.0;
+    for (const Bus& bus : catalogue_.GetBusesData()) {
+        const std::vector<int>& distances = catalogue_.GetRouteDistances(&bus);
+        for (size_t i = 0; i + 1 < bus.route.size(); ++i) {
+            if (double geo_length = points.ComputeDistance(bus.route[i]->id, bus.route[i + 1]->id); geo_length > 0.0) {
+                ratio = std::min(ratio, (distances[i + 1] - distances[i]) / geo_length);
             }
         }
-        
-        for (const auto& [span, record] : span_to_time) {
-            graph::Edge<Weight> edge{stop_to_vertices_[span.first->name].end,
-                                     stop_to_vertices_[span.second->name].begin,
-                                     record.time};
-            
-            graph_.AddEdge(edge);
-            
-            // добавим данные во вспомогательные объекты
-            edge_to_response_.emplace(edge, BusResponse(bus.name, record.span, record.time));
+    }
+    const double factor = ratio * (1.0 - 1e-9) / settings_.velocity;
+    
+    // у каждой остановки две вершины подряд, поэтому номер остановки -- это номер вершины, делённый на 2
+    std::vector<geo::Coordinates> coords;
+    coords.reserve(catalogue_.GetStopsData().size());
+    for (const Stop& stop : catalogue_.GetStopsData()) {
+        coords.push_back(stop.coords);
+    }
+    // а вершина цепочки стоит на остановке своей позиции маршрута
+    const graph::VertexId stop_vertex_count = static_cast<graph::VertexId>(coords.size() * 2);
+    std::vector<StopId> ride_stops;
+    if (settings_.graph_model == GraphModel::RIDE_CHAINS) {
+        ride_stops.reserve(CountGraphVertices() - stop_vertex_count);
+        for (const Bus& bus : catalogue_.GetBusesData()) {
+            for (const Stop* stop : bus.route) {
+                ride_stops.push_back(stop->id);
+            }
         }
     }
+    
+    return [coords = std::move(coords), points = std::move(points), ride_stops = std::move(ride_stops),
+            stop_vertex_count, factor](graph::VertexId vertex, graph::VertexId target) {
+        const StopId from = vertex < stop_vertex_count ? vertex / 2 : ride_stops[vertex - stop_vertex_count];
+        const StopId to = target / 2;
+        return coords[from] == coords[to] ? 0.0 : std::max(0.0, points.ComputeDistance(from, to) * factor);
+    };
+}
+
+std::optional<graph::Router<TransportRouter::Weight>::RoutesTable> TransportRouter::GetRoutesTable() const {
+    if (const auto* router = dynamic_cast<const graph::Router<Weight>*>(GetState()->router.get())) {
+        return router->GetRoutesTable();
+    }
+    return std::nullopt;
 }
 
 std::optional<TransportRouter::RouteResponse> TransportRouter::BuildRoute(std::string_view from,
                                                                           std::string_view to) const {
+    // состояние удерживается до конца запроса, даже если ApplyChanges тем временем опубликует новое
+    const std::shared_ptr<const State> state = GetState();
+    
+    const Stop* from_stop = catalogue_.GetStop(from);
+    const Stop* to_stop = catalogue_.GetStop(to);
+    if (!from_stop || !to_stop) {
+        throw std::out_of_range("Unknown stop "s + std::string(from_stop ? to : from));
+    }
+    
+    if (std::max(from_stop->id, to_stop->id) >= state->stop_count) {
+        return std::nullopt;
+    }
+    if (!state->route_cache) {
+        return FindRoute(*state, from_stop->id, to_stop->id);
+    }
+    
+    const uint64_t key = static_cast<uint64_t>(from_stop->id) << 32 | to_stop->id;
+    if (std::optional<std::shared_ptr<const RouteResponse>> cached = state->route_cache->Find(key)) {
+        ++cache_hits_;
+        return *cached ? std::optional<RouteResponse>(**cached) : std::nullopt;
+    }
+    ++cache_misses_;
+    
+    std::optional<RouteResponse> result = FindRoute(*state, from_stop->id, to_stop->id);
+    state->route_cache->Insert(key, result ? std::make_shared<const RouteResponse>(*result) : nullptr);
+    return result;
+}
+
+TransportRouter::CacheStats TransportRouter::GetCacheStats() const {
+    return {cache_hits_.load(), cache_misses_.load()};
+}
+
+std::optional<TransportRouter::RouteResponse> TransportRouter::FindRoute(const State& state, StopId from,
+                                                                         StopId to) const {
     std::optional<RouteResponse> result(std::nullopt);
-    if (auto route = router_->BuildRoute(stop_to_vertices_.at(from).begin, stop_to_vertices_.at(to).begin)) {
+    const graph::VertexId from_vertex = GetStopVertices(from).begin;
+    const graph::VertexId to_vertex = GetStopVertices(to).begin;
+    
+    if (auto route = state.router->BuildRoute(from_vertex, to_vertex)) {
         std::vector<ResponseItem> response_items;
         for (graph::EdgeId edge_id : route->edges) {
-            response_items.push_back(edge_to_response_.at(graph_.GetEdge(edge_id)));
+            const EdgeInfo& info = state.edge_infos[edge_id];
+            const Weight time = state.graph.GetEdge(edge_id).weight;
+            // подряд рёбра автобуса идут только в цепочке одного маршрута: это части одной поездки
+            if (info.kind == EdgeKind::BUS && !response_items.empty() && response_items.back().kind == EdgeKind::BUS) {
+                response_items.back().span += info.span;
+                response_items.back().time += time;
+            } else {
+                response_items.push_back({info.kind, info.index, info.span, time});
+            }
         }
         
         result.emplace(route->weight, std::move(response_items));
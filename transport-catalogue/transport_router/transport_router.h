@@ -1,84 +1,181 @@
 #pragma once
 
+#include "contraction_hierarchy.h"
+#include "dijkstra_router.h"
+#include "lru_cache.h"
 #include "router.h"
 #include "transport_catalogue.h"
 
+#include <atomic>
 #include <memory>
-#include <variant>
+#include <mutex>
 
 namespace router {
 
+// алгоритм поиска кратчайшего пути
+enum class RouterType {
+    FLOYD_WARSHALL,        // предрасчёт всех пар, годится только для небольших графов ALL_SPANS
+    DIJKSTRA,              // Дейкстра на двоичной куче по запросу
+    RADIX_DIJKSTRA,        // Дейкстра на радикс-куче по запросу
+    A_STAR,                // A* с оценкой по расстоянию по прямой до цели
+    CONTRACTION_HIERARCHY, // иерархия сжатия: самые быстрые запросы, но только на графе RIDE_CHAINS
+};
+
+// как поездки на автобусе представлены в графе
+enum class GraphModel {
+    ALL_SPANS,   // ребро на каждый отрезок маршрута: O(L^2) рёбер на автобус, но вершин только по две на остановку
+    RIDE_CHAINS, // цепочка вершин вдоль маршрута с рёбрами посадки и высадки: O(L) рёбер и вершин на автобус
+};
+
 struct RoutingSettings {
     int wait_time = 0;
     double velocity = 0.0;
+    RouterType router_type = RouterType::FLOYD_WARSHALL;
+    size_t thread_count = 1; // число потоков для предрасчёта Флойда-Уоршелла
+    GraphModel graph_model = GraphModel::ALL_SPANS;
+    size_t cache_capacity = 0; // сколько последних ответов на запросы маршрута помнить; 0 -- без кэша
 };
 
-// тип элементов поля "items" ответа на запрос "Route"
-struct WaitResponse {
-    WaitResponse(std::string_view stop, double time) : stop(stop), time(time) {}
-    
-    const std::string type{"Wait"};
-    std::string_view stop;
+// ожидание на остановке или поездка на автобусе
+enum class EdgeKind : uint32_t { WAIT, BUS };
+
+/*
+ * Элемент поля "items" ответа на запрос "Route". Остановка или автобус заданы номером в справочнике,
+ * а названия и текстовый тип элемента подставляются только при выводе ответа.
+ */
+struct ResponseItem {
+    EdgeKind kind;
+    uint32_t index; // номер остановки или автобуса в справочнике
+    int32_t span;   // число перегонов поездки, у ожидания 0
     double time;
 };
-struct BusResponse {
-    BusResponse(std::string_view bus, int span, double time) : bus(bus), span(span), time(time) {}
-    
-    const std::string type{"Bus"};
-    std::string_view bus;
-    int span;
-    double time;
+
+// что означает ребро графа; время -- это вес ребра
+struct EdgeInfo {
+    EdgeKind kind;
+    uint32_t index; // номер остановки или автобуса в справочнике
+    int32_t span;   // число перегонов поездки, у ожидания 0
 };
-using ResponseItem = std::variant<WaitResponse, BusResponse>;
 
+/*
+ * Маршрутизатор согласован с определённой версией справочника. После изменения справочника ApplyChanges
+ * забирает его журнал изменений и строит новое состояние, пересчитывая рёбра только затронутых автобусов;
+ * рёбра остальных копируются из прежнего графа. Новое состояние подменяет прежнее целиком, поэтому
+ * запросы, пришедшие во время обновления, отвечаются по прежнему согласованному состоянию.
+ * Справочник во время запросов и обновления меняться не должен, а обновлять маршрутизатор -- только один поток.
+ * Если справочник меняется под нагрузкой, у каждой его версии свой маршрутизатор (см. service::TransportService).
+ */
 class TransportRouter {
 public:
     using Weight = double;
     struct RouteResponse { Weight weight; std::vector<ResponseItem> response_items; };
+    struct CacheStats { size_t hits = 0, misses = 0; };
     
-    TransportRouter(RoutingSettings&& settings, const catalogue::TransportCatalogue& catalogue)
-        : settings_(std::move(settings)), catalogue_(catalogue)
-        , graph_(catalogue_.GetStopsData().size() * 2) {
-        
-        // вершины графа это остановки, рёбра – время ожидания на остановке или движения в автобусе
-        InitGraphWaitEdges();
-        InitGraphBusEdges();
-        
-        router_ = std::make_unique<graph::Router<Weight>>(graph_);
-    }
+    TransportRouter(RoutingSettings&& settings, const catalogue::TransportCatalogue& catalogue);
+    // восстановление из снимка базы: граф и таблица маршрутизатора могут ссылаться на память снимка
+    TransportRouter(RoutingSettings&& settings, const catalogue::TransportCatalogue& catalogue,
+                    graph::CsrGraph<Weight>&& graph, std::vector<EdgeInfo>&& edge_infos,
+                    std::optional<graph::Router<Weight>::RoutesTable> routes_table);
+    // маршрутизатор по изменённой копии справочника previous (например, по новой версии service::Base),
+    // построенный так же, как в ApplyChanges; previous при этом не меняется
+    TransportRouter(const TransportRouter& previous, const catalogue::TransportCatalogue& catalogue);
     TransportRouter(const TransportRouter&) = delete;
     TransportRouter(TransportRouter&&) = delete;
     
     TransportRouter& operator=(const TransportRouter&) = delete;
     TransportRouter& operator=(TransportRouter&&) = delete;
     
+    /*
+     * Остановки, добавленные в справочник после последнего ApplyChanges, ещё не связаны маршрутами.
+     * Ответы, в том числе об отсутствии маршрута, кэшируются по паре номеров остановок. Кэш принадлежит
+     * состоянию маршрутизатора, поэтому после ApplyChanges начинается пустым, а настройки после
+     * построения не меняются: устаревший ответ из кэша получить нельзя.
+     */
     std::optional<RouteResponse> BuildRoute(std::string_view from, std::string_view to) const;
+    // попадания и промахи кэша за всё время, включая прежние состояния; без кэша -- нули
+    CacheStats GetCacheStats() const;
+    
+    /*
+     * Учитывает изменения справочника после версии GetVersion(). Алгоритм поиска пути строится заново
+     * по новому графу: для Дейкстры и A* это бесплатно, а Флойд-Уоршелл и иерархия сжатия пересчитываются целиком.
+     */
+    void ApplyChanges();
+    // версия справочника, по которой построено текущее состояние
+    inline size_t GetVersion() const { return GetState()->version; }
+    
+    // доступ к построенным структурам для сохранения снимка базы; они действительны до следующего ApplyChanges
+    inline const RoutingSettings& GetSettings() const { return settings_; }
+    inline const graph::CsrGraph<Weight>& GetGraph() const { return GetState()->graph; }
+    inline const std::vector<EdgeInfo>& GetEdgeInfos() const { return GetState()->edge_infos; }
+    std::optional<graph::Router<Weight>::RoutesTable> GetRoutesTable() const;
     
 private:
-    void InitGraphWaitEdges();
-    void InitGraphBusEdges();
+    // у каждой остановки две вершины подряд: в begin автобус прибывает, из end отправляется после ожидания
+    struct StopVertices { graph::VertexId begin, end; };
+    static inline StopVertices GetStopVertices(catalogue::StopId stop) { return {2 * stop, 2 * stop + 1}; }
     
-    RoutingSettings settings_;
-    const catalogue::TransportCatalogue& catalogue_;
+    /*
+     * В модели RIDE_CHAINS за вершинами остановок идут вершины цепочек: по одной на каждую остановку
+     * каждого маршрута, автобусы подряд в порядке номеров. Поездка из end(A) в begin(B) -- это посадка
+     * (ребро в вершину цепочки, время 0), перегоны вдоль цепочки и высадка (ребро в begin, время 0).
+     * Посадка и высадка отвечают поездками с span 0, перегон -- с span 1, а BuildRoute
+     * складывает идущие подряд элементы автобуса в один, так что ответ тот же, что и в модели ALL_SPANS.
+     */
+    size_t CountGraphVertices() const;
     
-    // маршрутизатор нужно создавать после графа, поэтому объявим его как std::unique_ptr
-    graph::DirectedWeightedGraph<Weight> graph_;
-    std::unique_ptr<graph::Router<Weight>> router_;
+    using RouteCache = LruCache<uint64_t, std::shared_ptr<const RouteResponse>>;
     
-    // вспомогательные объекты для быстрого построения маршрутов после инициализации
-    struct StopVertices { graph::VertexId begin, end; };
+    // всё, что нужно для ответа на запросы; после публикации не меняется ничего, кроме содержимого кэша
+    struct State {
+        size_t version = 0;
+        size_t stop_count = 0; // остановки, добавленные позже, в графе ещё не представлены
+        graph::CsrGraph<Weight> graph;
+        // маршрутизатор ссылается на граф своего состояния
+        std::unique_ptr<graph::RouterBase<Weight>> router;
+        // ключ -- номера начальной и конечной остановок, значение -- ответ или nullptr, если маршрута нет;
+        // nullptr вместо кэша, если он выключен
+        std::unique_ptr<RouteCache> route_cache;
+        // по номерам рёбер графа: из них собирается ответ, и по ним при обновлении переносятся рёбра автобусов
+        std::vector<EdgeInfo> edge_infos;
+    };
     
-    struct EdgeHasher {
-        size_t operator()(const graph::Edge<Weight>& edge) const {
-            return hash(edge.from) + 31 * hash(edge.to) + 31 * 31 * hash_W(edge.weight);
+    // рёбра в порядке построения; в компактный граф они переводятся все сразу
+    struct GraphBuilder {
+        explicit GraphBuilder(size_t vertex_count) : graph(vertex_count) {}
+        
+        void AddEdge(const graph::Edge<Weight>& edge, EdgeInfo info) {
+            graph.AddEdge(edge);
+            infos.push_back(info);
         }
         
-        std::hash<size_t> hash;
-        std::hash<Weight> hash_W;
+        graph::DirectedWeightedGraph<Weight> graph;
+        std::vector<EdgeInfo> infos;
     };
     
-    std::unordered_map<std::string_view, StopVertices> stop_to_vertices_;
-    std::unordered_map<graph::Edge<Weight>, ResponseItem, EdgeHasher> edge_to_response_;
+    GraphBuilder MakeGraph() const;
+    void AddGraphWaitEdges(GraphBuilder& builder) const;
+    void AddGraphBusEdges(GraphBuilder& builder, const catalogue::Bus& bus) const;
+    void AddGraphRideEdges(GraphBuilder& builder) const;
+    std::shared_ptr<const State> MakeState(GraphBuilder&& builder, size_t version) const;
+    std::shared_ptr<const State> MakePatchedState(const State& previous) const;
+    std::shared_ptr<const State> GetState() const;
+    void SetState(std::shared_ptr<const State>&& state);
+    std::unique_ptr<graph::RouterBase<Weight>> MakeRouter(const graph::CsrGraph<Weight>& graph) const;
+    std::unique_ptr<RouteCache> MakeRouteCache() const;
+    // поиск пути без кэша; остановки уже представлены в графе состояния
+    std::optional<RouteResponse> FindRoute(const State& state, catalogue::StopId from, catalogue::StopId to) const;
+    
+    graph::DijkstraRouter<Weight>::Potential MakeGeoPotential() const;
+    
+    RoutingSettings settings_;
+    const catalogue::TransportCatalogue& catalogue_;
+    
+    // мьютекс защищает только сам указатель: запрос держит его лишь на время копирования
+    mutable std::mutex state_mutex_;
+    std::shared_ptr<const State> state_;
+    
+    mutable std::atomic<size_t> cache_hits_ = 0;
+    mutable std::atomic<size_t> cache_misses_ = 0;
 };
 
 } // namespace router
@@ -0,0 +1,18 @@
+#include "transport_service.h"
+
+namespace service {
+
+void TransportService::Update(const Change& change) {
+    versions_.Update([&change](const Base& current) {
+        auto next = std::make_unique<Base>(current.catalogue);
+        change(next->catalogue);
+        if (current.router) {
+            next->router = std::make_unique<router::TransportRouter>(*current.router, next->catalogue);
+        }
+        // маршрутизатор новой версии уже учёл журнал изменений, а прежние версии его не читают
+        next->catalogue.DiscardChanges(next->catalogue.GetVersion());
+        return next;
+    });
+}
+
+} // namespace service
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "rcu.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <functional>
+#include <memory>
+
+namespace service {
+
+// одна версия базы: справочник и маршрутизатор по нему; после публикации не меняется
+struct Base {
+    Base() = default;
+    // копия справочника прежней версии, которую можно менять; маршрутизатор задаётся отдельно
+    explicit Base(const catalogue::TransportCatalogue& previous) : catalogue(previous) {}
+    
+    catalogue::TransportCatalogue catalogue;
+    // nullptr, если маршруты не нужны; ссылается на catalogue этой же версии
+    std::unique_ptr<router::TransportRouter> router;
+};
+
+/*
+ * Справочник, который меняется под нагрузкой. Читатели отвечают на запросы по закреплённой версии базы
+ * и не ждут писателя, а писатель меняет копию справочника и публикует её вместе с маршрутизатором,
+ * пересчитанным только по затронутым автобусам. Справочник и маршрутизатор версии меняются только
+ * до её публикации, поэтому читатель никогда не видит справочник посреди изменения.
+ *
+ * Каждый поток-читатель заводит себе Reader:
+ *     service::TransportService::Reader reader(service.GetVersions());
+ *     auto base = reader.Pin();   // base->catalogue, base->router
+ */
+class TransportService {
+public:
+    using Versions = rcu::Versioned<Base>;
+    using Reader = Versions::Reader;
+    using Change = std::function<void(catalogue::TransportCatalogue&)>;
+    
+    explicit TransportService(std::unique_ptr<Base> initial) : versions_(std::move(initial)) {}
+    
+    /*
+     * Применяет change к копии текущей версии справочника и публикует новую версию. Писатели выполняются
+     * по очереди. Если change бросает исключение, ничего не публикуется и исключение передаётся дальше.
+     */
+    void Update(const Change& change);
+    
+    inline const Versions& GetVersions() const { return versions_; }
+    
+private:
+    Versions versions_;
+};
+
+} // namespace service